@@ -0,0 +1,118 @@
+#include "CubicInterpolation/Axis.h"
+#include "CubicInterpolation/BicubicSplines.h"
+#include "CubicInterpolation/CubicSplines.h"
+#include "CubicInterpolation/Interpolant.h"
+#include <benchmark/benchmark.h>
+#include <array>
+#include <random>
+#include <vector>
+
+using cubic_splines::ExpAxis;
+using cubic_splines::LinAxis;
+
+//
+// Compares the evaluation of an interpolant with the axes resolved through
+// the virtual Axis interface and with the axis types given as StaticAxes.
+//
+
+static auto make_cubic_def() {
+  auto def = cubic_splines::CubicSplines<double>::Definition();
+  def.f = [](double x) { return x * x; };
+  def.axis = std::make_unique<ExpAxis<double>>(1, 1e4, size_t{100});
+  return def;
+}
+
+static auto make_bicubic_def() {
+  auto def = cubic_splines::BicubicSplines<double>::Definition();
+  def.f = [](double x, double y) { return x * y; };
+  def.f_trafo = std::make_unique<ExpAxis<double>>(1, 0);
+  def.axis[0] = std::make_unique<ExpAxis<double>>(1, 1e4, size_t{100});
+  def.axis[1] = std::make_unique<LinAxis<double>>(1, 1e4, size_t{100});
+  return def;
+}
+
+static auto points(size_t n, size_t dim) {
+  auto gen = std::mt19937(42);
+  auto dis = std::uniform_real_distribution<double>(1, 1e4);
+  auto x = std::vector<double>(n * dim);
+  for (auto &xi : x)
+    xi = dis(gen);
+  return x;
+}
+
+template <typename Axes> static void BM_Cubic(benchmark::State &state) {
+  using spline_t = cubic_splines::CubicSplines<double>;
+  auto inter = cubic_splines::Interpolant<spline_t, spline_t::Definition, Axes>(
+      make_cubic_def());
+  auto x = points(1024, 1);
+  for (auto _ : state)
+    for (auto xi : x)
+      benchmark::DoNotOptimize(inter.evaluate(xi));
+  state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+template <typename Axes> static void BM_Bicubic(benchmark::State &state) {
+  using spline_t = cubic_splines::BicubicSplines<double>;
+  auto inter = cubic_splines::Interpolant<spline_t, spline_t::Definition, Axes>(
+      make_bicubic_def());
+  auto x = points(1024, 2);
+  for (auto _ : state)
+    for (size_t k = 0; k < x.size(); k += 2)
+      benchmark::DoNotOptimize(inter.evaluate(std::array<double, 2>{x[k], x[k + 1]}));
+  state.SetItemsProcessed(state.iterations() * x.size() / 2);
+}
+
+template <typename Axes> static void BM_BicubicDerivatives(benchmark::State &state) {
+  using spline_t = cubic_splines::BicubicSplines<double>;
+  auto inter = cubic_splines::Interpolant<spline_t, spline_t::Definition, Axes>(
+      make_bicubic_def());
+  auto x = points(1024, 2);
+  for (auto _ : state)
+    for (size_t k = 0; k < x.size(); k += 2)
+      benchmark::DoNotOptimize(
+          inter.evaluate_with_derivatives(std::array<double, 2>{x[k], x[k + 1]}, true));
+  state.SetItemsProcessed(state.iterations() * x.size() / 2);
+}
+
+//
+// Scalar and batch transformation of an exponential axis.
+//
+
+static void BM_AxisTransform(benchmark::State &state) {
+  auto axis = ExpAxis<double>(1, 1e14, size_t{100});
+  auto x = points(1024, 1);
+  for (auto _ : state) {
+    auto t = x;
+    for (auto &ti : t)
+      ti = axis.transform(ti);
+    benchmark::DoNotOptimize(t.data());
+  }
+  state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+static void BM_AxisTransformBatch(benchmark::State &state) {
+  auto axis = ExpAxis<double>(1, 1e14, size_t{100});
+  auto x = points(1024, 1);
+  for (auto _ : state) {
+    auto t = x;
+    axis.transform_n(t.data(), t.size());
+    benchmark::DoNotOptimize(t.data());
+  }
+  state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+BENCHMARK(BM_AxisTransform);
+BENCHMARK(BM_AxisTransformBatch);
+
+using cubic_axes_t = cubic_splines::StaticAxes<void, ExpAxis<double>>;
+using bicubic_axes_t =
+    cubic_splines::StaticAxes<ExpAxis<double>, ExpAxis<double>, LinAxis<double>>;
+
+BENCHMARK_TEMPLATE(BM_Cubic, cubic_splines::DynamicAxes);
+BENCHMARK_TEMPLATE(BM_Cubic, cubic_axes_t);
+BENCHMARK_TEMPLATE(BM_Bicubic, cubic_splines::DynamicAxes);
+BENCHMARK_TEMPLATE(BM_Bicubic, bicubic_axes_t);
+BENCHMARK_TEMPLATE(BM_BicubicDerivatives, cubic_splines::DynamicAxes);
+BENCHMARK_TEMPLATE(BM_BicubicDerivatives, bicubic_axes_t);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,162 @@
+#include "CubicInterpolation/Axis.h"
+#include "CubicInterpolation/BicubicSplines.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//
+// Compares the cell orders of the coefficient tables for uniformly distributed
+// and clustered queries. The cache and TLB misses per query are reported next
+// to the timings if the kernel permits to count them for the process, e.g.
+// not with perf_event_paranoid above 2 or in containers without perf events.
+//
+
+using spline_t = cubic_splines::BicubicSplines<double>;
+
+// misses of the calling thread, unavailable if they can not be counted
+class MissCounter {
+  int fd = -1;
+
+public:
+  enum class Event { cache, tlb };
+
+  explicit MissCounter(Event event) {
+#ifdef __linux__
+    auto attr = perf_event_attr();
+    attr.size = sizeof(attr);
+    if (event == Event::cache) {
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    } else {
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+    (void)event;
+#endif
+  }
+
+  MissCounter(MissCounter const &) = delete;
+  MissCounter &operator=(MissCounter const &) = delete;
+
+  ~MissCounter() {
+#ifdef __linux__
+    if (fd >= 0)
+      close(fd);
+#endif
+  }
+
+  bool available() const { return fd >= 0; }
+
+  void start() {
+#ifdef __linux__
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  // misses since start
+  double stop() {
+    auto count = std::uint64_t{0};
+#ifdef __linux__
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd, &count, sizeof(count)) != sizeof(count))
+        count = 0;
+    }
+#endif
+    return static_cast<double>(count);
+  }
+};
+
+static spline_t const &table(spline_t::CellOrder order, size_t n) {
+  static auto tables = std::map<std::pair<spline_t::CellOrder, size_t>, spline_t>();
+  auto it = tables.find({order, n});
+  if (it == tables.end()) {
+    auto def = spline_t::Definition();
+    def.f = [](double x, double y) { return x * y + y; };
+    def.approx_derivates = true;
+    // the cell order applies to the coefficients layout only
+    def.layout = spline_t::Layout::coefficients;
+    def.cell_order = order;
+    auto high = static_cast<double>(n - 1);
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(0, high, n);
+    def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(0, high, n);
+    it = tables.emplace(std::make_pair(order, n), spline_t(def)).first;
+  }
+  return it->second;
+}
+
+static auto uniform(size_t n_points, size_t n) {
+  auto gen = std::mt19937(42);
+  auto dis = std::uniform_real_distribution<double>(0, n - 1);
+  auto x = std::vector<double>(2 * n_points);
+  for (auto &xi : x)
+    xi = dis(gen);
+  return x;
+}
+
+// groups of queries scattered around random centers with a width of a few cells
+static auto clustered(size_t n_points, size_t n) {
+  auto gen = std::mt19937(42);
+  auto center = std::uniform_real_distribution<double>(0, n - 1);
+  auto x = std::vector<double>(2 * n_points);
+  auto c = std::array<double, 2>();
+  for (size_t k = 0; k < n_points; ++k) {
+    if (k % 64 == 0)
+      c = {center(gen), center(gen)};
+    auto dis = std::normal_distribution<double>(0, 4);
+    for (size_t i = 0; i < 2; ++i)
+      x[2 * k + i] = std::min(std::max(c[i] + dis(gen), 0.), n - 1.);
+  }
+  return x;
+}
+
+static void BM_CellOrder(benchmark::State &state) {
+  auto order = static_cast<spline_t::CellOrder>(state.range(0));
+  auto n = static_cast<size_t>(state.range(1));
+  auto const &spline = table(order, n);
+  auto n_points = size_t{1} << 16;
+  auto x = state.range(2) ? clustered(n_points, n) : uniform(n_points, n);
+  auto out = std::vector<double>(n_points);
+  MissCounter cache(MissCounter::Event::cache);
+  MissCounter tlb(MissCounter::Event::tlb);
+  auto cache_count = 0., tlb_count = 0.;
+  for (auto _ : state) {
+    cache.start();
+    tlb.start();
+    spline.evaluate(x.data(), out.data(), n_points);
+    benchmark::DoNotOptimize(out.data());
+    tlb_count += tlb.stop();
+    cache_count += cache.stop();
+  }
+  state.SetItemsProcessed(state.iterations() * n_points);
+  auto queries = static_cast<double>(state.iterations() * n_points);
+  if (cache.available())
+    state.counters["cache_misses"] = cache_count / queries;
+  if (tlb.available())
+    state.counters["tlb_misses"] = tlb_count / queries;
+}
+
+// order (0: column major, 1: tiled, 2: morton), nodes per axis, clustered queries
+BENCHMARK(BM_CellOrder)->ArgsProduct({{0, 1, 2}, {128, 1024}, {0, 1}});
+
+BENCHMARK_MAIN();
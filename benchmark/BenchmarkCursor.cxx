@@ -0,0 +1,87 @@
+#include "CubicInterpolation/Axis.h"
+#include "CubicInterpolation/BicubicSplines.h"
+#include "CubicInterpolation/CubicSplines.h"
+#include <benchmark/benchmark.h>
+#include <array>
+#include <random>
+#include <vector>
+
+//
+// Compares the cold lookup of the splines with the cursor for queries along a
+// track, which mostly stay in the same cell. The axis transformations are not
+// part of the comparison.
+//
+
+static auto track(size_t n, size_t dim, double high) {
+  auto gen = std::mt19937(42);
+  auto step = std::normal_distribution<double>(0, 0.01);
+  auto x = std::vector<double>(n * dim, high / 2);
+  for (size_t k = dim; k < x.size(); ++k)
+    x[k] = x[k - dim] + step(gen);
+  return x;
+}
+
+static auto make_cubic() {
+  auto def = cubic_splines::CubicSplines<double>::Definition();
+  def.f = [](double x) { return x * x; };
+  def.axis = std::make_unique<cubic_splines::LinAxis<double>>(0, 99, size_t{100});
+  return cubic_splines::CubicSplines<double>(def);
+}
+
+static auto make_bicubic(cubic_splines::BicubicSplines<double>::Layout layout) {
+  auto def = cubic_splines::BicubicSplines<double>::Definition();
+  def.f = [](double x, double y) { return x * y; };
+  def.approx_derivates = true;
+  def.layout = layout;
+  def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(0, 99, size_t{100});
+  def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(0, 99, size_t{100});
+  return cubic_splines::BicubicSplines<double>(def);
+}
+
+static void BM_Cubic(benchmark::State &state) {
+  auto spline = make_cubic();
+  auto x = track(1024, 1, 99);
+  for (auto _ : state)
+    for (auto xi : x)
+      benchmark::DoNotOptimize(spline.evaluate(xi));
+  state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+static void BM_CubicCursor(benchmark::State &state) {
+  auto spline = make_cubic();
+  auto cursor = spline.cursor();
+  auto x = track(1024, 1, 99);
+  for (auto _ : state)
+    for (auto xi : x)
+      benchmark::DoNotOptimize(cursor.evaluate(xi));
+  state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+static void BM_Bicubic(benchmark::State &state) {
+  auto layout = static_cast<cubic_splines::BicubicSplines<double>::Layout>(state.range(0));
+  auto spline = make_bicubic(layout);
+  auto x = track(1024, 2, 99);
+  for (auto _ : state)
+    for (size_t k = 0; k < x.size(); k += 2)
+      benchmark::DoNotOptimize(spline.evaluate(x[k], x[k + 1]));
+  state.SetItemsProcessed(state.iterations() * x.size() / 2);
+}
+
+static void BM_BicubicCursor(benchmark::State &state) {
+  auto layout = static_cast<cubic_splines::BicubicSplines<double>::Layout>(state.range(0));
+  auto spline = make_bicubic(layout);
+  auto cursor = spline.cursor();
+  auto x = track(1024, 2, 99);
+  for (auto _ : state)
+    for (size_t k = 0; k < x.size(); k += 2)
+      benchmark::DoNotOptimize(cursor.evaluate(x[k], x[k + 1]));
+  state.SetItemsProcessed(state.iterations() * x.size() / 2);
+}
+
+BENCHMARK(BM_Cubic);
+BENCHMARK(BM_CubicCursor);
+// 0: matrices, 1: coefficients, 2: nodes layout
+BENCHMARK(BM_Bicubic)->Arg(0)->Arg(1)->Arg(2);
+BENCHMARK(BM_BicubicCursor)->Arg(0)->Arg(1)->Arg(2);
+
+BENCHMARK_MAIN();
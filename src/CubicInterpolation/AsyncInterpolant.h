@@ -0,0 +1,175 @@
+#pragma once
+
+#include "CubicInterpolation/Interpolant.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace cubic_splines {
+
+/**
+ * @brief Evaluation of an AsyncInterpolant before its tables are ready. With
+ * *wait* the call blocks until the tables have been built or loaded, with
+ * *direct* the function of the definition is called instead.
+ */
+enum class Pending { wait, direct };
+
+namespace detail {
+
+template <typename F, typename T,
+          std::enable_if_t<std::is_floating_point<T>::value, bool> = true>
+auto evaluate_direct(F const &f, T x) {
+  return f(x);
+}
+
+template <typename T, typename T1>
+auto evaluate_direct(std::function<T(T, T)> const &f, T1 const &x) {
+  return f(x[0], x[1]);
+}
+
+template <typename T, size_t N, typename T1>
+auto evaluate_direct(std::function<T(std::array<T, N> const &)> const &f, T1 const &x) {
+  auto p = std::array<T, N>();
+  for (size_t i = 0; i < N; ++i)
+    p[i] = x[i];
+  return f(p);
+}
+
+template <typename T> void evaluate_direct_n(std::function<T(T)> const &f, T const *x,
+                                             T *out, size_t n) {
+  for (size_t k = 0; k < n; ++k)
+    out[k] = f(x[k]);
+}
+
+template <typename T>
+void evaluate_direct_n(std::function<T(T, T)> const &f, T const *x, T *out, size_t n) {
+  for (size_t k = 0; k < n; ++k)
+    out[k] = f(x[2 * k], x[2 * k + 1]);
+}
+
+template <typename T, size_t N>
+void evaluate_direct_n(std::function<T(std::array<T, N> const &)> const &f, T const *x,
+                       T *out, size_t n) {
+  for (size_t k = 0; k < n; ++k)
+    out[k] = evaluate_direct(f, x + N * k);
+}
+} // namespace detail
+
+/**
+ * @brief Interpolant whose tables are built or loaded on a background thread,
+ * the constructor returns immediately. Until the tables are ready, evaluate
+ * waits for them or calls the function of the definition directly, see
+ * Pending. Derivatives always wait for the tables. The function is called by
+ * the build and the direct evaluation at the same time and has to be thread
+ * safe. An exception of the build is rethrown by the first call which
+ * requires the tables. The destructor waits for a running build.
+ */
+template <typename T1, typename T2 = typename T1::Definition, typename T3 = DynamicAxes>
+class AsyncInterpolant {
+  using interpolant_t = Interpolant<T1, T2, T3>;
+
+  decltype(T2::f) f; // copy of the function for the direct evaluation
+  Pending pending;
+  std::shared_future<std::shared_ptr<interpolant_t const>> future;
+  mutable std::atomic<interpolant_t const *> ready;
+
+  // the tables if they are ready, without blocking
+  interpolant_t const *poll() const {
+    auto p = ready.load(std::memory_order_acquire);
+    if (!p && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      p = future.get().get();
+      ready.store(p, std::memory_order_release);
+    }
+    return p;
+  }
+
+  bool direct() const { return pending == Pending::direct && f; }
+
+public:
+  /**
+   * @brief Start the build or the loading of the tables, see Interpolant for
+   * the arguments.
+   */
+  AsyncInterpolant(T2 &&def, std::string path = "", std::string filename = "",
+                   Pending _pending = Pending::wait)
+      : f(def.f), pending(_pending), ready(nullptr) {
+    auto build = [](T2 def, std::string path, std::string filename) {
+      return std::make_shared<interpolant_t const>(std::move(def), path, filename);
+    };
+    future = std::async(std::launch::async, build, std::move(def), std::move(path),
+                        std::move(filename))
+                 .share();
+  }
+
+  AsyncInterpolant(AsyncInterpolant &&other)
+      : f(std::move(other.f)), pending(other.pending), future(std::move(other.future)),
+        ready(other.ready.load()) {}
+
+  AsyncInterpolant(AsyncInterpolant const &) = delete;
+  AsyncInterpolant &operator=(AsyncInterpolant const &) = delete;
+
+  /**
+   * @brief Whether the build has finished, calls do not block anymore.
+   */
+  bool is_ready() const {
+    return ready.load(std::memory_order_acquire) ||
+           future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  /**
+   * @brief Block until the tables are ready and return the interpolant, which
+   * lives as long as this object.
+   */
+  interpolant_t const &wait() const {
+    auto p = future.get().get();
+    ready.store(p, std::memory_order_release);
+    return *p;
+  }
+
+  template <typename T> auto evaluate(T x) const {
+    using result_t = decltype(std::declval<interpolant_t const &>().evaluate(x));
+    if (auto p = poll())
+      return p->evaluate(x);
+    if (direct())
+      return static_cast<result_t>(detail::evaluate_direct(f, x));
+    return wait().evaluate(x);
+  }
+
+  /**
+   * @brief Evaluation of *n* points at once, see Interpolant for the memory
+   * layout.
+   */
+  template <typename T> void evaluate(T const *x, T *out, size_t n) const {
+    if (auto p = poll())
+      p->evaluate(x, out, n);
+    else if (direct())
+      detail::evaluate_direct_n(f, x, out, n);
+    else
+      wait().evaluate(x, out, n);
+  }
+
+  template <typename T> auto prime(T x) const { return wait().prime(x); }
+
+  template <typename T> void prime(T const *x, T *out, size_t n) const {
+    wait().prime(x, out, n);
+  }
+
+  template <typename T>
+  auto evaluate_with_derivatives(T x, bool second = false) const {
+    return wait().evaluate_with_derivatives(x, second);
+  }
+
+  /**
+   * @brief Definition of interpolant, available once the tables are ready.
+   */
+  T2 const &GetDefinition() const { return wait().GetDefinition(); }
+};
+
+} // namespace cubic_splines
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cmath>
+#include <cstddef>
+#include <memory>
 #include <ostream>
+#include <vector>
 
 namespace cubic_splines {
 /**
@@ -17,7 +21,8 @@ protected:
     os << "low: " << low << ", high: " << high << ", stepsize: " << stepsize;
   };
 
-  /* friend std::ostream &operator<<(std::ostream &out, const Axis<T> &); */
+  template <typename U>
+  friend std::ostream &operator<<(std::ostream &out, const Axis<U> &);
 
 public:
   /**
@@ -46,6 +51,14 @@ public:
    */
   virtual T back_transform(T) const = 0;
 
+  /**
+   * @brief Batch versions of transform and back_transform, applied in place
+   * to *n* consecutive values. If not overwritten, the scalar versions are
+   * called for every value.
+   */
+  virtual void transform_n(T *x, size_t n) const;
+  virtual void back_transform_n(T *t, size_t n) const;
+
   /**
    * @brief Calculates the required number of nodes.
    */
@@ -71,6 +84,14 @@ public:
    */
   virtual T derive(T x) const = 0;
   virtual T back_derive(T x) const = 0;
+
+  /**
+   * @brief Second derivate of the Axis forward and backward transformation.
+   * If not overwritten, they are approximated by finite differences of the
+   * first derivates.
+   */
+  virtual T double_derive(T x) const;
+  virtual T back_double_derive(T x) const;
 };
 
 template <typename T> std::ostream &operator<<(std::ostream &out, const Axis<T> &axis) {
@@ -105,8 +126,14 @@ public:
   T transform(T x) const final;
   T back_transform(T t) const final;
 
+  void transform_n(T *x, size_t n) const final;
+  void back_transform_n(T *t, size_t n) const final;
+
   T derive(T x) const final;
   T back_derive(T t) const final;
+
+  T double_derive(T x) const final;
+  T back_double_derive(T t) const final;
 };
 
 /**
@@ -131,8 +158,14 @@ public:
   T transform(T x) const final;
   T back_transform(T t) const final;
 
+  void transform_n(T *x, size_t n) const final;
+  void back_transform_n(T *t, size_t n) const final;
+
   T derive(T x) const final;
   T back_derive(T t) const final;
+
+  T double_derive(T x) const final;
+  T back_double_derive(T t) const final;
 };
 
 /**
@@ -159,7 +192,128 @@ public:
 
   T transform(T x) const final;
   T back_transform(T x) const final;
+  void transform_n(T *x, size_t n) const final;
+  void back_transform_n(T *x, size_t n) const final;
   T derive(T) const final;
   T back_derive(T x) const final;
+
+  T double_derive(T) const final;
+  T back_double_derive(T) const final;
+};
+
+/**
+ * @brief Axis which splits the cells of a base axis locally. The cell *c* of
+ * the base axis is split into \f$ 2^{\text{level}_c} \f$ cells. The
+ * transformed value of the base axis is mapped monotonically onto the nodes,
+ * the slope of the map blends polynomially between the base nodes, so the
+ * transformation stays three times continuously differentiable and the
+ * accuracy of the splines is kept where the nodes are graded. Cells whose
+ * neighbours have the same level are split evenly and keep the nodes of the
+ * lower levels, the levels of neighbouring cells should differ by at most one.
+ */
+template <typename T> class RefinedAxis : public Axis<T> {
+  std::unique_ptr<Axis<T>> base;
+  std::vector<unsigned int> levels_; // of the cells of the base axis
+  std::vector<T> first;              // node at the start of every base cell
+  std::vector<T> slope;              // of the map at the base nodes
+  std::vector<T> bump;               // added to the blended slope of every cell
+
+  void print(std::ostream &os) const {
+    os << "RefinedAxis(" << *base << ", levels:";
+    for (auto l : levels_)
+      os << " " << l;
+    os << ")";
+  }
+
+  void update();
+
+  // node of the base coordinate t and the first and second derivative of the map
+  T map(T t, T &d1, T &d2) const;
+
+  // base coordinate of the node u
+  T unmap(T u) const;
+
+public:
+  /**
+   * @brief Refined axis with the level of every cell of the base axis, by
+   * default the cells are not split.
+   */
+  explicit RefinedAxis(std::unique_ptr<Axis<T>> _base);
+  RefinedAxis(std::unique_ptr<Axis<T>> _base, std::vector<unsigned int> _levels);
+
+  Axis<T> const &base_axis() const noexcept { return *base; }
+  std::vector<unsigned int> const &levels() const noexcept { return levels_; }
+
+  /**
+   * @brief Raise the level of the base cells which contain a flagged cell of
+   * this axis, *cells* holds a flag for every cell. The levels of the
+   * neighbours are raised as far as required to keep the levels of
+   * neighbouring cells within one.
+   */
+  void refine(std::vector<bool> const &cells);
+
+  T transform(T x) const final;
+  T back_transform(T t) const final;
+
+  T derive(T x) const final;
+  T back_derive(T t) const final;
+
+  T double_derive(T x) const final;
+  T back_double_derive(T t) const final;
 };
+
+namespace detail {
+// natural logarithm of two, M_LN2 is not available on every platform
+constexpr double ln2 = 0.693147180559945309417232121458176568;
+} // namespace detail
+
+//
+// The transformations are defined inline, to be inlined into the evaluation
+// if the axis type is known at compile time.
+//
+
+template <typename T> inline T ExpAxis<T>::transform(T x) const {
+  return std::log(x / this->low) / this->stepsize;
+}
+
+template <typename T> inline T ExpAxis<T>::back_transform(T t) const {
+  return this->low * std::exp(t * this->stepsize);
+}
+
+template <typename T> inline T ExpAxis<T>::derive(T x) const {
+  return 1. / (x * this->stepsize);
+}
+
+template <typename T> inline T ExpAxis<T>::back_derive(T t) const {
+  return this->low * this->stepsize * std::exp(t * this->stepsize);
+}
+
+template <typename T> inline T ExpM1Axis<T>::transform(T x) const {
+  return (std::log1p(x / this->low) - detail::ln2) / this->stepsize;
+}
+
+template <typename T> inline T ExpM1Axis<T>::back_transform(T t) const {
+  return this->low * std::expm1(t * this->stepsize + detail::ln2);
+}
+
+template <typename T> inline T ExpM1Axis<T>::derive(T x) const {
+  return 1. / (this->stepsize * (x + this->low));
+}
+
+template <typename T> inline T ExpM1Axis<T>::back_derive(T t) const {
+  return this->low * this->stepsize * std::exp(t * this->stepsize + detail::ln2);
+}
+
+template <typename T> inline T LinAxis<T>::transform(T x) const {
+  return (x - this->low) / this->stepsize;
+}
+
+template <typename T> inline T LinAxis<T>::back_transform(T x) const {
+  return x * this->stepsize + this->low;
+}
+
+template <typename T> inline T LinAxis<T>::derive(T) const { return 1. / this->stepsize; }
+
+template <typename T> inline T LinAxis<T>::back_derive(T) const { return this->stepsize; }
+
 } // namespace cubic_splines
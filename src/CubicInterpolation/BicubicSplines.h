@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Axis.h"
+#include "BuildStatistics.h"
+#include "Derivatives.h"
+#include "Executor.h"
 
 #include <array>
 #include <functional>
@@ -8,16 +11,24 @@
 #include <vector>
 
 namespace cubic_splines {
+namespace detail {
+template <typename T> class Checkpoint;
+} // namespace detail
 
 /**
  * @brief Two dimensional cubic splines class. Tables are build from the lower
  * limit zero with a stepsize from one. If a function has an different
  * definition area it will be  transformed with the Axis transformations
  * specified in the BicubicSplines::Definition.
+ *
+ * The tables are evaluated with the precision *T* and stored with the
+ * precision *S*, e.g. `BicubicSplines<double, float>` halves the memory of the
+ * tables while the evaluation is carried out in double precision.
  */
-template <typename T> class BicubicSplines {
+template <typename T, typename S = T> class BicubicSplines {
 public:
   using type = T;
+  using storage_type = S;
   /**
    * @brief Storage class to write and load the interpolation tables from  disk.
    * After reading and writing the object will be destructed.
@@ -28,14 +39,71 @@ public:
 
   static constexpr size_t N = 2;
 
+  /**
+   * @brief Memory layout of the runtime tables. With *coefficients* the 16
+   * polynomial coefficients of every cell are calculated once after building or
+   * loading the table and stored contiguously, which reduces an evaluation to a
+   * cell lookup and a Horner scheme. The *matrices* layout keeps the node
+   * values and derivatives in separate matrices and assembles the polynomial on
+   * every call, which requires a quarter of the memory. The *nodes* layout
+   * requires the same memory but interleaves the value and derivatives of
+   * every node into a record, so a cell is read from two pairs of neighbouring
+   * records instead of eight matrix columns. It is the layout of the stored
+   * tables, which are mapped into memory and used without a copy, and the
+   * default. The other layouts convert a loaded table into a copy.
+   */
+  enum class Layout { matrices, coefficients, nodes };
+
+  /**
+   * @brief Order of the cells in the coefficients layout. The *column_major*
+   * order follows the node matrices. The *tiled* order stores blocks of 8 x 8
+   * cells contiguously and the *morton* order follows the Z-order curve, both
+   * keep neighbouring cells close in memory and reduce the cache and TLB misses
+   * of scattered queries into large tables at the cost of some padding.
+   */
+  enum class CellOrder { column_major, tiled, morton };
+
+  /**
+   * @brief Source of the derivatives at the nodes. With *sampled* the function
+   * is evaluated at additional points around the nodes for finite
+   * differences, at every node or only at the boundaries of the table if the
+   * derivatives are approximated. With *grid* the derivatives are calculated
+   * from the sampled node values alone, by spline interpolation with one sided
+   * differences of fourth order at the boundaries, so a table of *n0 x n1*
+   * nodes requires exactly *n0 * n1* function evaluations. The splines are
+   * used independent of `approx_derivates`.
+   */
+  enum class DerivativeSource { sampled, grid };
+
   /**
    * @brief Properties of an *2-dim* interpolation object.
    */
   struct Definition {
     std::function<T(T, T)> f;                     // function to evaluate
+    // optional batch evaluation of f at the points (x0[k], x1[k]) for k < n,
+    // preferred to f if set
+    std::function<void(T const *x0, T const *x1, T *out, size_t n)> f_batch;
     std::unique_ptr<Axis<T>> f_trafo;             // trafo of function values
     std::array<std::unique_ptr<Axis<T>>, N> axis; // trafo of axis
     bool approx_derivates;
+    Layout layout = Layout::nodes; // memory layout of the runtime tables
+    CellOrder cell_order = CellOrder::column_major; // order of the cells
+    DerivativeSource derivatives = DerivativeSource::sampled; // of the nodes
+    Executor executor; // runs the build in parallel, serial if empty
+    BuildStatistics *statistics = nullptr; // records the build if set
+    // store the sampled function values of a build with a table file in
+    // `<filename>.checkpoint` and resume from it if the build has been aborted
+    bool checkpoint = false;
+    // sample the tables tile by tile on the first query of a tile instead of
+    // up front, the built tiles are written to the table file when the tables
+    // are released; the axes, trafo and statistics have to outlive the tables,
+    // f has to be thread safe if the tables are queried from several threads;
+    // requires sampled derivatives without approx_derivates
+    bool lazy = false;
+    // bytes of the tiles kept in memory by out-of-core tables, which are read
+    // on demand from `<filename>.tiles` next to the table file; the tables
+    // are kept in memory completely if zero; lazy tables are kept in memory
+    size_t memory_budget = 0;
 
     const std::array<std::unique_ptr<Axis<T>>, N> &GetAxis() const { return axis; };
   };
@@ -43,26 +111,61 @@ public:
   BicubicSplines(Definition const &);
   BicubicSplines(Definition const &, std::string, std::string);
 
+  /**
+   * @brief Sample the share *shard* of *shards* of the function values of a
+   * build and store them in `<filename>.shard<shard>` in the directory
+   * *path*. Every shard samples a contiguous range of the nodes and of the
+   * boundaries, so the shards can be built by separate processes sharing the
+   * filesystem, e.g. jobs of a batch system. An aborted shard resumes from its
+   * file. Lazy tables can not be built in shards.
+   */
+  static void build_shard(Definition const &, std::string path, std::string filename,
+                          size_t shard, size_t shards);
+
+  /**
+   * @brief Combine the values of all shards of a build, calculate the
+   * derivatives and save the tables as *filename*. Throws if a shard is missing
+   * or has not been finished, or if the table file exists already. The shard
+   * files are deleted once the tables have been saved.
+   */
+  static BicubicSplines merge_shards(Definition const &, std::string path,
+                                     std::string filename, size_t shards);
+
 protected:
   BicubicSplines(RuntimeData);
+  BicubicSplines(Definition const &, detail::Checkpoint<T> *);
+
+  // the modes of the constructor with a table file: out-of-core tables, tables
+  // which are loaded or else built, and the loaded tables by their format
+  void open_paged(Definition const &, std::string const &path,
+                  std::string const &filename);
+  void open_tables(Definition const &, std::string const &path,
+                   std::string const &filename);
+  void open_mapped(Definition const &, std::string const &file);
+  void open_stored(Definition const &, std::string const &path,
+                   std::string const &filename);
+  void build_tables(Definition const &, std::string const &path,
+                    std::string const &filename);
 
   std::shared_ptr<RuntimeData> data;
 
+  size_t evaluations = 0;
+
   std::tuple<T, T> back_transform(Definition const &, long unsigned int,
                                   long unsigned int) const;
 
-  template <typename T1>
-  std::array<T, 2> _prime(T1 func, std::array<std::unique_ptr<Axis<T>>, 2> const &axis,
-                          unsigned int n1, unsigned int n2);
-
-  /* template <typename T1> */
-  /* std::vector<std::tuple<unsigned int, T>> _prime(std::vector<T> const &yi, T1 func, */
-  /*                                                 unsigned int n_max); */
+public:
+  /**
+   * @brief Number of points at which the function has been evaluated to build
+   * the tables, zero if they have been loaded from disk.
+   */
+  size_t function_evaluations() const { return evaluations; }
 
-  template <typename T1>
-  T _double_prime(Definition const &def, T1 func, unsigned int n1, unsigned int n2);
+  /**
+   * @brief Tile counters of out-of-core tables, zero for tables in memory.
+   */
+  PageStatistics page_statistics() const;
 
-public:
   /**
    * @brief Calculate the function value to the given axis. The interpolated
    * value with no knowledge about the transformation which might has choosen.
@@ -74,16 +177,146 @@ public:
     return evaluate(iterable[0], iterable[1]);
   }
 
+  /**
+   * @brief Evaluate *n* points at once. The coordinates of the *k*-th point are
+   * expected at `x[2 * k]` and `x[2 * k + 1]`.
+   */
+  void evaluate(T const *x, T *out, size_t n) const;
+
+  /**
+   * @brief Gradient of the interpolated function, calculated analytically from
+   * the polynomial of the cell.
+   */
   std::array<T, 2> prime(T x0, T x1) const;
 
   template <typename T1> auto prime(T1 iterable) const {
     return prime(iterable[0], iterable[1]);
   }
 
+  /**
+   * @brief Gradient of *n* points at once. The gradient of the *k*-th point is
+   * written to `out[2 * k]` and `out[2 * k + 1]`.
+   */
+  void prime(T const *x, T *out, size_t n) const;
+
+  /**
+   * @brief Mixed second derivative \f$ \partial^2 f / \partial x_0 \partial x_1 \f$.
+   */
   T double_prime(T x0, T x1) const;
 
   template <typename T1> auto double_prime(T1 iterable) const {
     return double_prime(iterable[0], iterable[1]);
   }
+
+  /**
+   * @brief Second derivatives \f$ \partial^2 f / \partial x_0^2 \f$,
+   * \f$ \partial^2 f / \partial x_1^2 \f$ and
+   * \f$ \partial^2 f / \partial x_0 \partial x_1 \f$, calculated analytically
+   * from the polynomial of the cell.
+   */
+  std::array<T, 3> hessian(T x0, T x1) const;
+
+  template <typename T1> auto hessian(T1 iterable) const {
+    return hessian(iterable[0], iterable[1]);
+  }
+
+  /**
+   * @brief Function value, gradient and optionally the second derivatives from
+   * a single cell lookup. The second derivatives are stored in the same order
+   * as returned by hessian.
+   */
+  Derivatives<T, N> evaluate_with_derivatives(T x0, T x1, bool second = false) const;
+
+  template <typename T1>
+  auto evaluate_with_derivatives(T1 iterable, bool second = false) const {
+    return evaluate_with_derivatives(iterable[0], iterable[1], second);
+  }
+
+  /**
+   * @brief Stateful evaluator for sequential queries. The polynomial of the
+   * last cell is cached and reused as long as the queries stay in that cell,
+   * the neighbouring cells are reached without a new lookup. A cursor keeps
+   * the tables alive and is not thread safe.
+   */
+  class Cursor {
+    std::shared_ptr<RuntimeData const> data;
+    // range of the cached cell, empty before the first query
+    std::array<T, 2> low = {1, 1}, high = {0, 0};
+    std::array<T, 2> node = {0, 0};
+    std::array<T, 16> c; // polynomial coefficients of the cached cell, c[4 * i + j]
+
+    Cursor(std::shared_ptr<RuntimeData const> _data) : data(std::move(_data)) {}
+
+    void seek(T x0, T x1);
+
+    void locate(T x0, T x1) {
+      if (!(x0 >= low[0] && x0 < high[0] && x1 >= low[1] && x1 < high[1]))
+        seek(x0, x1);
+    }
+
+    // polynomials in the second coordinate and their derivatives
+    void rows(T v, T *r, T *dr, T *d2r) const {
+      for (size_t i = 0; i < 4; ++i) {
+        auto ci = c.data() + 4 * i;
+        r[i] = ((ci[3] * v + ci[2]) * v + ci[1]) * v + ci[0];
+        dr[i] = (3 * ci[3] * v + 2 * ci[2]) * v + ci[1];
+        d2r[i] = 6 * ci[3] * v + 2 * ci[2];
+      }
+    }
+
+    friend class BicubicSplines;
+
+  public:
+    T evaluate(T x0, T x1) {
+      locate(x0, x1);
+      auto u = x0 - node[0];
+      auto v = x1 - node[1];
+      T r[4];
+      for (size_t i = 0; i < 4; ++i)
+        r[i] = ((c[4 * i + 3] * v + c[4 * i + 2]) * v + c[4 * i + 1]) * v + c[4 * i];
+      return ((r[3] * u + r[2]) * u + r[1]) * u + r[0];
+    }
+
+    template <typename T1> auto evaluate(T1 iterable) {
+      return evaluate(iterable[0], iterable[1]);
+    }
+
+    Derivatives<T, N> evaluate_with_derivatives(T x0, T x1, bool second = false) {
+      locate(x0, x1);
+      auto u = x0 - node[0];
+      auto v = x1 - node[1];
+      T r[4], dr[4], d2r[4];
+      rows(v, r, dr, d2r);
+      auto res = Derivatives<T, N>();
+      res.value = ((r[3] * u + r[2]) * u + r[1]) * u + r[0];
+      res.gradient[0] = (3 * r[3] * u + 2 * r[2]) * u + r[1];
+      res.gradient[1] = ((dr[3] * u + dr[2]) * u + dr[1]) * u + dr[0];
+      res.hessian.fill(0);
+      if (second) {
+        res.hessian[0] = 6 * r[3] * u + 2 * r[2];
+        res.hessian[1] = ((d2r[3] * u + d2r[2]) * u + d2r[1]) * u + d2r[0];
+        res.hessian[2] = (3 * dr[3] * u + 2 * dr[2]) * u + dr[1];
+      }
+      return res;
+    }
+
+    template <typename T1>
+    auto evaluate_with_derivatives(T1 iterable, bool second = false) {
+      return evaluate_with_derivatives(iterable[0], iterable[1], second);
+    }
+
+    std::array<T, 2> prime(T x0, T x1) {
+      return evaluate_with_derivatives(x0, x1).gradient;
+    }
+
+    template <typename T1> auto prime(T1 iterable) {
+      return prime(iterable[0], iterable[1]);
+    }
+  };
+
+  /**
+   * @brief Cursor starting without a cached cell.
+   */
+  Cursor cursor() const { return Cursor(data); }
 };
 } // namespace cubic_splines
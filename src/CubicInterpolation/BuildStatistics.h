@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace cubic_splines {
+
+/**
+ * @brief Record of a table build. If it is set in the Definition, the
+ * constructors append the wall time of every phase and accumulate the
+ * function evaluations, so one object can collect several builds. Loading
+ * tables from disk is recorded as the phase *load*, which precedes the build
+ * phases if the tables have not been found.
+ */
+struct BuildStatistics {
+  struct Phase {
+    std::string name;
+    double seconds; // wall time
+  };
+
+  std::vector<Phase> phases;       // in the order they have been run
+  size_t function_evaluations = 0; // points at which the function was evaluated
+  size_t peak_memory = 0;          // bytes of the runtime tables
+  size_t serialized_bytes = 0;     // size of the written or loaded table file
+
+  // called from the constructing thread with the running phase and its
+  // completed fraction
+  std::function<void(std::string const &phase, double fraction)> progress;
+
+  /**
+   * @brief Total wall time of the phases with the given name.
+   */
+  double seconds(std::string const &name) const {
+    auto sum = 0.;
+    for (auto const &p : phases)
+      if (p.name == name)
+        sum += p.seconds;
+    return sum;
+  }
+};
+
+/**
+ * @brief Counters of the tiles of out-of-core tables, which are read from disk
+ * on demand and kept resident up to a memory budget.
+ */
+struct PageStatistics {
+  size_t hits = 0;           // queries of resident tiles
+  size_t misses = 0;         // tiles read from disk
+  size_t evictions = 0;      // tiles dropped to keep the budget
+  size_t resident_bytes = 0; // memory of the resident tiles
+};
+} // namespace cubic_splines
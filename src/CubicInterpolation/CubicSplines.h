@@ -1,9 +1,13 @@
 #pragma once
 
+#include <array>
 #include <functional>
 #include <memory>
 
 #include "Axis.h"
+#include "BuildStatistics.h"
+#include "Derivatives.h"
+#include "Executor.h"
 
 namespace cubic_splines {
 /**
@@ -27,8 +31,13 @@ public:
    */
   struct Definition {
     std::function<T(T)> f;                                     // function to evaluate
+    // optional batch evaluation of f at the points x[k] for k < n, preferred to
+    // f if set
+    std::function<void(T const *x, T *out, size_t n)> f_batch;
     std::unique_ptr<cubic_splines::Axis<T>> f_trafo = nullptr; // trafo of function values
     std::unique_ptr<cubic_splines::Axis<T>> axis;              // trafo of axis
+    Executor executor; // samples the nodes in parallel, serial if empty
+    BuildStatistics *statistics = nullptr; // records the build if set
 
     const Axis<T> &GetAxis() const { return *axis; };
   };
@@ -38,6 +47,7 @@ public:
 
 private:
   CubicSplines(RuntimeData);
+  CubicSplines(Definition const &, StorageData const &);
 
   std::shared_ptr<RuntimeData> data;
 
@@ -48,10 +58,74 @@ public:
    */
   T evaluate(T x) const;
 
+  /**
+   * @brief Evaluate *n* points at once and write the results to *out*.
+   */
+  void evaluate(T const *x, T *out, size_t n) const;
+
   T prime(T x) const;
 
+  /**
+   * @brief First derive of *n* points at once.
+   */
+  void prime(T const *x, T *out, size_t n) const;
+
   T double_prime(T x) const;
-};
 
+  /**
+   * @brief Function value, first and optionally second derivative at once.
+   */
+  Derivatives<T, N> evaluate_with_derivatives(T x, bool second = false) const;
+
+  /**
+   * @brief Stateful evaluator for sequential queries. The polynomial of the
+   * last cell is cached and reused as long as the queries stay in that cell,
+   * the neighbouring cells are reached without a new lookup. A cursor keeps
+   * the tables alive and is not thread safe.
+   */
+  class Cursor {
+    std::shared_ptr<RuntimeData const> data;
+    T low = 1, high = 0; // range of the cached cell, empty before the first query
+    T node = 0;
+    std::array<T, 4> c; // polynomial coefficients of the cached cell
+
+    Cursor(std::shared_ptr<RuntimeData const> _data) : data(std::move(_data)) {}
+
+    void seek(T x);
+
+    friend class CubicSplines;
+
+  public:
+    T evaluate(T x) {
+      if (!(x >= low && x < high))
+        seek(x);
+      auto u = x - node;
+      return ((c[3] * u + c[2]) * u + c[1]) * u + c[0];
+    }
+
+    T prime(T x) {
+      if (!(x >= low && x < high))
+        seek(x);
+      auto u = x - node;
+      return (3 * c[3] * u + 2 * c[2]) * u + c[1];
+    }
+
+    Derivatives<T, N> evaluate_with_derivatives(T x, bool second = false) {
+      if (!(x >= low && x < high))
+        seek(x);
+      auto u = x - node;
+      auto r = Derivatives<T, N>();
+      r.value = ((c[3] * u + c[2]) * u + c[1]) * u + c[0];
+      r.gradient[0] = (3 * c[3] * u + 2 * c[2]) * u + c[1];
+      r.hessian[0] = second ? 6 * c[3] * u + 2 * c[2] : T(0);
+      return r;
+    }
+  };
+
+  /**
+   * @brief Cursor starting without a cached cell.
+   */
+  Cursor cursor() const { return Cursor(data); }
+};
 
 } // namespace cubic_splines
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace cubic_splines {
+/**
+ * @brief Function value together with its derivatives, as returned by the
+ * evaluate_with_derivatives calls. The second derivatives are only calculated
+ * if requested. They are stored with the pure derivatives
+ * \f$ \partial^2 f / \partial x_i^2 \f$ first, followed by the mixed
+ * derivatives \f$ \partial^2 f / \partial x_i \partial x_j \f$ with
+ * \f$ i < j \f$ in lexicographic order.
+ */
+template <typename T, size_t N> struct Derivatives {
+  T value;
+  std::array<T, N> gradient;
+  std::array<T, N*(N + 1) / 2> hessian;
+};
+} // namespace cubic_splines
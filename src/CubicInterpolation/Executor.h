@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace cubic_splines {
+
+/**
+ * @brief Runs the tasks `task(i)` for `i < n`, possibly concurrently, and
+ * returns after all of them have finished. The table builds hand their
+ * independent work to an executor if one is set in the Definition, so the
+ * function to interpolate has to be safe to call from several threads at once.
+ * Every task writes separate entries of the tables, the result is identical to
+ * the serial build.
+ */
+using Executor = std::function<void(size_t n, std::function<void(size_t)> const &task)>;
+
+/**
+ * @brief Executor distributing the tasks dynamically over the given number of
+ * threads, the calling thread included. The worker threads are started once
+ * and shared by the copies of the executor, they are joined when the last
+ * copy is destructed. The first exception thrown by a task is rethrown after
+ * the other tasks in progress have finished.
+ */
+Executor thread_executor(unsigned int threads);
+
+/**
+ * @brief Run the tasks with the executor or serially if none is set.
+ */
+inline void execute(Executor const &executor, size_t n,
+                    std::function<void(size_t)> const &task) {
+  if (executor) {
+    executor(n, task);
+    return;
+  }
+  for (size_t i = 0; i < n; ++i)
+    task(i);
+}
+} // namespace cubic_splines
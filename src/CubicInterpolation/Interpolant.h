@@ -5,28 +5,28 @@
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace cubic_splines {
 
 /**
  * @brief Utility class for a better handling of interpolants. Take care about
  * transformation of axis building, loading and storage of intepolation tables.
+ * By default the axis transformations are called through the virtual Axis
+ * interface. If the concrete axis types are passed as StaticAxes, they are
+ * resolved at compile time and the transformations can be inlined.
  */
-template <typename T1, typename T2 = typename T1::Definition> class Interpolant {
+template <typename T1, typename T2 = typename T1::Definition, typename T3 = DynamicAxes>
+class Interpolant {
   T2 def;
+  detail::AxisTransform<T3> axes;
   T1 inter;
 
-  template <typename... Args> inline auto transform(Args &&...args) const {
-    return detail::transform(std::forward<Args>(args)...);
-  }
-
   template <typename... Args> inline auto back_transform(Args &&...args) const {
     return detail::back_transform(std::forward<Args>(args)...);
   }
 
-  template <typename... Args> inline auto back_transform_prime(Args &&...args) const {
-    return detail::back_transform_prime(args...);
-  }
+  static constexpr size_t N = T1::N;
 
 public:
   /**
@@ -36,7 +36,7 @@ public:
    * be stored and a warning thrown because they cann't be reused.
    */
   Interpolant(T2 &&_def, std::string _path = "", std::string _filename = "")
-      : def(std::forward<T2>(_def)), inter(def, _path, _filename) {}
+      : def(std::forward<T2>(_def)), axes(def), inter(def, _path, _filename) {}
 
   /**
    * @brief Evaluation of the interpolant, takeing axis and function value
@@ -45,8 +45,8 @@ public:
    * stored in same order as axis is required.
    */
   template <typename T> inline auto evaluate(T x) const {
-    auto val = inter.evaluate(transform(def.GetAxis(), x));
-    return back_transform(def.f_trafo.get(), val);
+    auto val = inter.evaluate(axes.transform(def, x));
+    return back_transform(axes.trafo(def), val);
   }
 
   /**
@@ -56,11 +56,89 @@ public:
    * stored in same order as axis is required.
    */
   template <typename T> inline auto prime(T x) const {
-    auto f = inter.evaluate(transform(def.GetAxis(), x));
-    auto df = inter.prime(transform(def.GetAxis(), x));
-    return back_transform_prime(def.f_trafo.get(), def.GetAxis(), f, df, x);
+    return detail::to_gradient(x, evaluate_with_derivatives(x).gradient);
+  }
+
+  /**
+   * @brief Function value, gradient and optionally the second derivatives of
+   * the interpolant from a single axis transformation and cell lookup. The
+   * derivatives of the transformations entering the chain rule are calculated
+   * once. See Derivatives for the order of the second derivatives.
+   */
+  template <typename T>
+  inline auto evaluate_with_derivatives(T x, bool second = false) const {
+    auto r = inter.evaluate_with_derivatives(axes.transform(def, x), second);
+    auto dt = axes.derivatives(def, x, second);
+    return detail::back_transform_derivatives(axes.trafo(def), dt, r, second);
   }
 
+  /**
+   * @brief Evaluation of *n* points at once. The points are stored
+   * consecutively, for a multidimensional interpolant the *i*-th coordinate of
+   * the *k*-th point is found at `x[k * N + i]`. The axis transformation, the
+   * evaluation and the back transformation are each performed over the whole
+   * batch.
+   */
+  template <typename T> void evaluate(T const *x, T *out, size_t n) const {
+    auto t = std::vector<T>(x, x + n * N);
+    axes.transform_n(def, t.data(), n);
+    inter.evaluate(t.data(), out, n);
+    detail::back_transform_n(axes.trafo(def), out, n);
+  }
+
+  /**
+   * @brief First derive of *n* points at once, stored in the same order as
+   * the points. See evaluate for the memory layout.
+   */
+  template <typename T> void prime(T const *x, T *out, size_t n) const {
+    auto t = std::vector<T>(x, x + n * N);
+    axes.transform_n(def, t.data(), n);
+    auto f = std::vector<T>();
+    if (axes.trafo(def)) {
+      f.resize(n);
+      inter.evaluate(t.data(), f.data(), n);
+    }
+    inter.prime(t.data(), out, n);
+    axes.derive_n(def, x, t.data(), n);
+    detail::back_transform_prime_n(axes.trafo(def), f.data(), t.data(), out, n, N);
+  }
+
+  /**
+   * @brief Stateful evaluator for sequential, locally correlated queries. The
+   * axis transformations are applied on every call, the spline keeps the
+   * polynomial of the last cell. Refers to the Interpolant, which has to
+   * outlive the cursor. Available for spline kinds providing a Cursor.
+   */
+  class Cursor {
+    Interpolant const &parent;
+    typename T1::Cursor cursor;
+
+  public:
+    Cursor(Interpolant const &_parent)
+        : parent(_parent), cursor(_parent.inter.cursor()) {}
+
+    template <typename T> auto evaluate(T x) {
+      auto val = cursor.evaluate(parent.axes.transform(parent.def, x));
+      return parent.back_transform(parent.axes.trafo(parent.def), val);
+    }
+
+    template <typename T> auto evaluate_with_derivatives(T x, bool second = false) {
+      auto const &p = parent;
+      auto r = cursor.evaluate_with_derivatives(p.axes.transform(p.def, x), second);
+      auto dt = p.axes.derivatives(p.def, x, second);
+      return detail::back_transform_derivatives(p.axes.trafo(p.def), dt, r, second);
+    }
+
+    template <typename T> auto prime(T x) {
+      return detail::to_gradient(x, evaluate_with_derivatives(x).gradient);
+    }
+  };
+
+  /**
+   * @brief Cursor starting without a cached cell.
+   */
+  Cursor cursor() const { return Cursor(*this); }
+
   /**
    * @brief Definition of interpolant.
    */
@@ -1,9 +1,35 @@
+#pragma once
+
 #include "CubicInterpolation/Axis.h"
+#include "CubicInterpolation/Derivatives.h"
 
+#include <array>
+#include <cstddef>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace cubic_splines {
+/**
+ * @brief Axis types of an Interpolant resolved at runtime through the virtual
+ * Axis interface of the Definition. This is the default.
+ */
+struct DynamicAxes {};
+
+/**
+ * @brief Concrete types of the function value trafo and of the axes of an
+ * Interpolant, in the same order as in the Definition. Use `void` as trafo
+ * type if no function value trafo is set. The transformations are called
+ * without virtual dispatch and can be inlined into the evaluation. The types
+ * are checked when the Interpolant is constructed.
+ */
+template <typename Trafo, typename... Axes> struct StaticAxes {};
+
 namespace detail {
 
 typedef Axis<double> Axis;
@@ -25,6 +51,54 @@ template <typename T> auto back_transform(T trafo, double val) {
   return val;
 }
 
+/**
+ * @brief Transform *n* coordinates stored with the given stride. Contiguous
+ * double values are passed to the batch transformation of the axis. The axis
+ * type is deduced, so the concrete axes of StaticAxes are called directly.
+ */
+template <typename A, typename T>
+void transform_strided_n(A const &axis, T *x, size_t n, size_t stride) {
+  for (size_t k = 0; k < n; ++k)
+    x[k * stride] = axis.transform(x[k * stride]);
+}
+
+template <typename A>
+void transform_strided_n(A const &axis, double *x, size_t n, size_t stride) {
+  if (stride == 1)
+    return axis.transform_n(x, n);
+  auto buffer = std::vector<double>(n);
+  for (size_t k = 0; k < n; ++k)
+    buffer[k] = x[k * stride];
+  axis.transform_n(buffer.data(), n);
+  for (size_t k = 0; k < n; ++k)
+    x[k * stride] = buffer[k];
+}
+
+/**
+ * @brief Batch version of transform. The points are stored consecutively, the
+ * *i*-th coordinate of the *n*-th point is found at `x[n * dim + i]`.
+ */
+template <typename T> void transform_n(Axis const &axis, T *x, size_t n) {
+  transform_strided_n(axis, x, n, 1);
+}
+
+template <typename T1, typename T2> void transform_n(T1 const &axis, T2 *x, size_t n) {
+  auto dim = axis.size();
+  for (auto i = 0u; i < dim; ++i)
+    transform_strided_n(*axis[i], x + i, n, dim);
+}
+
+template <typename T1, typename T2> void back_transform_n(T1 trafo, T2 *val, size_t n) {
+  if (trafo)
+    for (size_t k = 0; k < n; ++k)
+      val[k] = trafo->back_transform(val[k]);
+}
+
+template <typename T> void back_transform_n(T trafo, double *val, size_t n) {
+  if (trafo)
+    trafo->back_transform_n(val, n);
+}
+
 template <typename T>
 auto back_transform_prime(T trafo, Axis const &axis, double f, double df, double x) {
   if (trafo)
@@ -40,5 +114,272 @@ auto back_transform_prime(T1 trafo, T2 const &axis, double f, T3 df, T3 x) {
   return df;
 }
 
+/**
+ * @brief Batch version of the axis derivates, stored in the same order as the
+ * points.
+ */
+template <typename T> void derive_n(Axis const &axis, T const *x, T *dt, size_t n) {
+  for (size_t k = 0; k < n; ++k)
+    dt[k] = axis.derive(x[k]);
+}
+
+template <typename T1, typename T2>
+void derive_n(T1 const &axis, T2 const *x, T2 *dt, size_t n) {
+  auto dim = axis.size();
+  for (auto i = 0u; i < dim; ++i) {
+    auto const &ax = *axis[i];
+    for (size_t k = 0; k < n; ++k)
+      dt[k * dim + i] = ax.derive(x[k * dim + i]);
+  }
+}
+
+/**
+ * @brief Batch version of back_transform_prime with the axis derivates of
+ * every coordinate passed in *dt*. The function values are only required if a
+ * function value trafo is set.
+ */
+template <typename T1, typename T2>
+void back_transform_prime_n(T1 trafo, T2 const *f, T2 const *dt, T2 *df, size_t n,
+                            size_t dim) {
+  if (trafo)
+    for (size_t k = 0; k < n; ++k) {
+      auto dfdt = trafo->back_derive(f[k]);
+      for (size_t i = 0; i < dim; ++i)
+        df[k * dim + i] *= dfdt;
+    }
+  for (size_t k = 0; k < n * dim; ++k)
+    df[k] *= dt[k];
+}
+
+/**
+ * @brief First and, if requested, second derivatives of the axis
+ * transformations at the given point.
+ */
+template <typename T, std::enable_if_t<std::is_floating_point<T>::value, bool> = true>
+auto axis_derivatives(Axis const &axis, T x, bool second) {
+  auto d = std::array<std::array<double, 1>, 2>{};
+  d[0][0] = axis.derive(x);
+  if (second)
+    d[1][0] = axis.double_derive(x);
+  return d;
+}
+
+template <typename T1, typename T2>
+auto axis_derivatives(T1 const &axis, T2 const &x, bool second) {
+  auto d = std::array<std::array<double, std::tuple_size<T1>::value>, 2>{};
+  for (auto i = 0u; i < axis.size(); ++i) {
+    d[0][i] = axis[i]->derive(x[i]);
+    if (second)
+      d[1][i] = axis[i]->double_derive(x[i]);
+  }
+  return d;
+}
+
+/**
+ * @brief Apply the chain rule of the function value and axis transformation
+ * to the derivatives calculated in the transformed space. The derivatives of
+ * the transformations are passed in and evaluated once per point.
+ */
+template <typename T1, typename T2, size_t N>
+auto back_transform_derivatives(T1 trafo, std::array<std::array<double, N>, 2> const &dt,
+                                Derivatives<T2, N> r, bool second) {
+  auto f = r.value;
+  auto grad = r.gradient;
+  auto dg = T2(1);
+  auto d2g = T2(0);
+  if (trafo) {
+    r.value = trafo->back_transform(f);
+    dg = trafo->back_derive(f);
+    if (second)
+      d2g = trafo->back_double_derive(f);
+  }
+  for (size_t i = 0; i < N; ++i)
+    r.gradient[i] = dg * grad[i] * dt[0][i];
+  if (second) {
+    for (size_t i = 0; i < N; ++i)
+      r.hessian[i] = d2g * grad[i] * grad[i] * dt[0][i] * dt[0][i] +
+                     dg * (r.hessian[i] * dt[0][i] * dt[0][i] + grad[i] * dt[1][i]);
+    auto k = N;
+    for (size_t i = 0; i < N; ++i)
+      for (size_t j = i + 1; j < N; ++j, ++k)
+        r.hessian[k] = (d2g * grad[i] * grad[j] + dg * r.hessian[k]) * dt[0][i] * dt[0][j];
+  }
+  return r;
+}
+
+/**
+ * @brief Convert the gradient into the type of the point, a floatingpoint for
+ * one dimensional interpolants and the container type otherwise.
+ */
+template <typename T, std::enable_if_t<std::is_floating_point<T>::value, bool> = true>
+auto to_gradient(T, std::array<double, 1> const &grad) {
+  return grad[0];
+}
+
+template <typename T1, typename T2> auto to_gradient(T1 x, T2 const &grad) {
+  for (auto i = 0u; i < grad.size(); ++i)
+    x[i] = grad[i];
+  return x;
+}
+
+/**
+ * @brief Transformations of an Interpolant through the virtual Axis interface.
+ */
+template <typename T> struct AxisTransform {
+  template <typename Def> AxisTransform(Def const &) {}
+
+  template <typename Def> auto trafo(Def const &def) const { return def.f_trafo.get(); }
+
+  template <typename Def, typename T1> auto transform(Def const &def, T1 x) const {
+    return detail::transform(def.GetAxis(), x);
+  }
+
+  template <typename Def, typename T1>
+  auto derivatives(Def const &def, T1 const &x, bool second) const {
+    return axis_derivatives(def.GetAxis(), x, second);
+  }
+
+  template <typename Def, typename T1>
+  void transform_n(Def const &def, T1 *x, size_t n) const {
+    detail::transform_n(def.GetAxis(), x, n);
+  }
+
+  template <typename Def, typename T1>
+  void derive_n(Def const &def, T1 const *x, T1 *dt, size_t n) const {
+    detail::derive_n(def.GetAxis(), x, dt, n);
+  }
+};
+
+/**
+ * @brief Placeholder for a missing function value trafo in StaticAxes.
+ */
+struct NoTrafo {
+  double back_transform(double t) const { return t; }
+  void back_transform_n(double *, size_t) const {}
+  double back_derive(double) const { return 1; }
+  double back_double_derive(double) const { return 0; }
+};
+
+template <typename T> struct StaticTrafo { using type = T; };
+template <> struct StaticTrafo<void> { using type = NoTrafo; };
+
+template <typename T1, typename T2> T1 const *checked_cast(T2 const *ptr) {
+  auto res = dynamic_cast<T1 const *>(ptr);
+  if (ptr && !res)
+    throw std::invalid_argument("Axis type of the definition does not match the "
+                                "static axis type of the Interpolant.");
+  return res;
+}
+
+template <typename T> T const *axis_ptr(T const &ax, size_t) { return &ax; }
+
+template <typename T, size_t N>
+T const *axis_ptr(std::array<std::unique_ptr<T>, N> const &ax, size_t i) {
+  return ax[i].get();
+}
+
+/**
+ * @brief Transformations of an Interpolant with axis types known at compile
+ * time. Pointers to the concrete axes are resolved once, the axes are owned
+ * by the Definition and keep their address if it is moved.
+ */
+template <typename Trafo, typename... Axes> struct AxisTransform<StaticAxes<Trafo, Axes...>> {
+  static constexpr size_t N = sizeof...(Axes);
+  using trafo_t = typename StaticTrafo<Trafo>::type;
+  using indices = std::index_sequence_for<Axes...>;
+
+  trafo_t const *f_trafo = nullptr;
+  std::tuple<Axes const *...> axis;
+
+  template <typename Def>
+  AxisTransform(Def const &def) : axis(init(def.GetAxis(), indices{})) {
+    if (!std::is_same<Trafo, void>::value)
+      f_trafo = checked_cast<trafo_t>(def.f_trafo.get());
+    else if (def.f_trafo)
+      throw std::invalid_argument("Definition has a function value trafo, but the "
+                                  "Interpolant is declared without.");
+  }
+
+  template <typename T1, size_t... I>
+  static auto init(T1 const &ax, std::index_sequence<I...>) {
+    return std::make_tuple(checked_cast<Axes>(axis_ptr(ax, I))...);
+  }
+
+  template <typename Def> auto trafo(Def const &) const { return f_trafo; }
+
+  template <typename Def, typename T1,
+            std::enable_if_t<std::is_floating_point<T1>::value, bool> = true>
+  auto transform(Def const &, T1 x) const {
+    return std::get<0>(axis)->transform(x);
+  }
+
+  template <typename Def, typename T1,
+            std::enable_if_t<!std::is_floating_point<T1>::value, bool> = true>
+  auto transform(Def const &, T1 x) const {
+    return transform(x, indices{});
+  }
+
+  template <typename T1, size_t... I>
+  auto transform(T1 x, std::index_sequence<I...>) const {
+    using expander = int[];
+    (void)expander{0, (x[I] = std::get<I>(axis)->transform(x[I]), 0)...};
+    return x;
+  }
+
+  template <typename Def, typename T1,
+            std::enable_if_t<std::is_floating_point<T1>::value, bool> = true>
+  auto derivatives(Def const &, T1 x, bool second) const {
+    auto d = std::array<std::array<double, 1>, 2>{};
+    d[0][0] = std::get<0>(axis)->derive(x);
+    if (second)
+      d[1][0] = std::get<0>(axis)->double_derive(x);
+    return d;
+  }
+
+  template <typename Def, typename T1,
+            std::enable_if_t<!std::is_floating_point<T1>::value, bool> = true>
+  auto derivatives(Def const &, T1 const &x, bool second) const {
+    return derivatives(x, second, indices{});
+  }
+
+  template <typename T1, size_t... I>
+  auto derivatives(T1 const &x, bool second, std::index_sequence<I...>) const {
+    auto d = std::array<std::array<double, N>, 2>{};
+    using expander = int[];
+    (void)expander{0, (d[0][I] = std::get<I>(axis)->derive(x[I]), 0)...};
+    if (second)
+      (void)expander{0, (d[1][I] = std::get<I>(axis)->double_derive(x[I]), 0)...};
+    return d;
+  }
+
+  template <typename Def, typename T1>
+  void transform_n(Def const &, T1 *x, size_t n) const {
+    transform_n(x, n, indices{});
+  }
+
+  template <typename T1, size_t... I>
+  void transform_n(T1 *x, size_t n, std::index_sequence<I...>) const {
+    using expander = int[];
+    (void)expander{0, (transform_strided_n(*std::get<I>(axis), x + I, n, N), 0)...};
+  }
+
+  template <typename Def, typename T1>
+  void derive_n(Def const &, T1 const *x, T1 *dt, size_t n) const {
+    derive_n(x, dt, n, indices{});
+  }
+
+  template <typename T1, size_t... I>
+  void derive_n(T1 const *x, T1 *dt, size_t n, std::index_sequence<I...>) const {
+    using expander = int[];
+    (void)expander{0, (strided_derive(*std::get<I>(axis), x + I, dt + I, n), 0)...};
+  }
+
+  template <typename T1, typename T2>
+  static void strided_derive(T1 const &ax, T2 const *x, T2 *dt, size_t n) {
+    for (size_t k = 0; k < n; ++k)
+      dt[k * N] = ax.derive(x[k * N]);
+  }
+};
+
 } // namespace detail
 } // namespace cubic_splines
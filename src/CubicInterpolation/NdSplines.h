@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Axis.h"
+#include "Derivatives.h"
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace cubic_splines {
+
+/**
+ * @brief N dimensional tensor product cubic B-splines. Tables are build from
+ * the lower limit zero with a stepsize from one in every dimension. If a
+ * function has an different definition area it will be transformed with the
+ * Axis transformations specified in the NdSplines::Definition. The
+ * derivatives at the boundaries are estimated from the nodes, every axis
+ * requires at least five nodes. Instantiated for N = 2, 3 and 4.
+ */
+template <typename T, size_t Dim> class NdSplines {
+public:
+  using type = T;
+
+  /**
+   * @brief Storage class to write and load the interpolation tables from disk.
+   * After reading and writing the object will be destructed.
+   */
+  struct StorageData;
+
+  struct RuntimeData;
+
+  static constexpr size_t N = Dim;
+
+  /**
+   * @brief Memory layout of the runtime coefficients. The *tensor* layout
+   * keeps the B-spline coefficients in a single tensor and reads the *4^N*
+   * coefficients around a cell as *4^(N-1)* runs of four values. The *cells*
+   * layout stores the coefficients around every cell contiguously, so a query
+   * reads a single block, at about *4^N* times the memory. It is the default up
+   * to N = 3.
+   */
+  enum class Layout { tensor, cells };
+
+  /**
+   * @brief Properties of an *N-dim* interpolation object.
+   */
+  struct Definition {
+    std::function<T(std::array<T, N> const &)> f; // function to evaluate
+    // optional batch evaluation of f at the points (x[0][k], ..., x[N-1][k])
+    // for k < n, preferred to f if set
+    std::function<void(std::array<T const *, N> const &x, T *out, size_t n)> f_batch;
+    std::unique_ptr<Axis<T>> f_trafo;             // trafo of function values
+    std::array<std::unique_ptr<Axis<T>>, N> axis; // trafo of axis
+    Layout layout = N <= 3 ? Layout::cells : Layout::tensor; // of the coefficients
+
+    const std::array<std::unique_ptr<Axis<T>>, N> &GetAxis() const { return axis; };
+  };
+
+  NdSplines(Definition const &);
+  NdSplines(Definition const &, std::string, std::string);
+
+protected:
+  NdSplines(RuntimeData);
+
+  std::shared_ptr<RuntimeData> data;
+
+  template <typename T1> static std::array<T, N> to_point(T1 const &iterable) {
+    auto x = std::array<T, N>();
+    for (size_t i = 0; i < N; ++i)
+      x[i] = iterable[i];
+    return x;
+  }
+
+public:
+  /**
+   * @brief Calculate the function value to the given axis. The interpolated
+   * value with no knowledge about the transformation which might has choosen.
+   * Requires an iterable container with the *x_i* values stored.
+   */
+  T evaluate(std::array<T, Dim> const &x) const;
+
+  template <typename T1> auto evaluate(T1 const &iterable) const {
+    return evaluate(to_point(iterable));
+  }
+
+  /**
+   * @brief Evaluate *n* points at once. The *i*-th coordinate of the *k*-th
+   * point is expected at `x[k * N + i]`.
+   */
+  void evaluate(T const *x, T *out, size_t n) const;
+
+  /**
+   * @brief Gradient of the interpolated function.
+   */
+  std::array<T, Dim> prime(std::array<T, Dim> const &x) const;
+
+  template <typename T1> auto prime(T1 const &iterable) const {
+    return prime(to_point(iterable));
+  }
+
+  /**
+   * @brief Gradient of *n* points at once, stored in the same order as the
+   * points.
+   */
+  void prime(T const *x, T *out, size_t n) const;
+
+  /**
+   * @brief Function value, gradient and optionally the second derivatives from
+   * a single read of the coefficients around the point. See Derivatives for
+   * the order of the second derivatives.
+   */
+  Derivatives<T, Dim> evaluate_with_derivatives(std::array<T, Dim> const &x,
+                                                bool second = false) const;
+
+  template <typename T1>
+  auto evaluate_with_derivatives(T1 const &iterable, bool second = false) const {
+    return evaluate_with_derivatives(to_point(iterable), second);
+  }
+};
+} // namespace cubic_splines
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace cubic_splines {
+
+/**
+ * @brief Outcome of the refinement of the axes of a definition.
+ */
+template <size_t N> struct Refinement {
+  std::array<unsigned int, N> nodes; // nodes of the refined axes
+  unsigned int levels = 0;           // refinement steps which have been made
+  double error = 0; // largest deviation at the midpoints relative to the tolerance
+  bool converged = false;
+  size_t function_evaluations = 0; // distinct points the function has been evaluated at
+};
+
+/**
+ * @brief Refine the axes of the definition until the tables meet the
+ * tolerance. The axes of the definition are the coarsest grid. On every level
+ * the tables are built and compared with the function at the midpoints
+ * between the nodes. The midpoints between neighbouring nodes along a single
+ * axis attribute the error to that axis, only those axes are refined which
+ * exceed the tolerance, so smooth directions keep their nodes. Of a refined
+ * axis only the cells containing a failing midpoint are split, the axis is
+ * replaced by a RefinedAxis around the original one. The function values are
+ * kept during the refinement, so the nodes and midpoints which are sampled
+ * again on a later level are not evaluated twice.
+ * The tolerance is met if \f$ |s - f| \le \text{rel} \cdot |f| + \text{abs} \f$
+ * holds at every midpoint. The refined definition builds and stores the
+ * tables like any other.
+ */
+template <typename T1>
+Refinement<T1::N> refine_axes(typename T1::Definition &def,
+                              typename T1::type rel_tolerance,
+                              typename T1::type abs_tolerance = 0,
+                              unsigned int max_levels = 8);
+
+} // namespace cubic_splines
@@ -1,5 +1,11 @@
 #include "CubicInterpolation/Axis.h"
+#include "detail/VectorMath.h"
+
+#include <algorithm>
+#include <boost/math/differentiation/finite_difference.hpp>
 #include <cmath>
+#include <limits>
+#include <stdexcept>
 
 using namespace cubic_splines;
 
@@ -11,6 +17,26 @@ template <typename T> unsigned int Axis<T>::required_nodes() const {
   return std::round(transform(high) + 1u);
 }
 
+template <typename T> void Axis<T>::transform_n(T *x, size_t n) const {
+  for (size_t k = 0; k < n; ++k)
+    x[k] = transform(x[k]);
+}
+
+template <typename T> void Axis<T>::back_transform_n(T *t, size_t n) const {
+  for (size_t k = 0; k < n; ++k)
+    t[k] = back_transform(t[k]);
+}
+
+template <typename T> T Axis<T>::double_derive(T x) const {
+  using boost::math::differentiation::finite_difference_derivative;
+  return finite_difference_derivative([this](T x) { return derive(x); }, x);
+}
+
+template <typename T> T Axis<T>::back_double_derive(T t) const {
+  using boost::math::differentiation::finite_difference_derivative;
+  return finite_difference_derivative([this](T t) { return back_derive(t); }, t);
+}
+
 //
 // Exp Axis
 //
@@ -23,19 +49,28 @@ ExpAxis<T>::ExpAxis(T _low, T _high, size_t _nodes) : Axis<T>(_low, _high, 0.f)
   this->stepsize = std::log(_high / _low) / static_cast<T>(_nodes - 1);
 }
 
-template <typename T> T ExpAxis<T>::transform(T x) const {
-  return std::log(x / this->low) / this->stepsize;
+template <typename T> void ExpAxis<T>::transform_n(T *x, size_t n) const {
+  for (size_t k = 0; k < n; ++k)
+    x[k] /= this->low;
+  detail::log_n(x, n);
+  for (size_t k = 0; k < n; ++k)
+    x[k] /= this->stepsize;
 }
 
-template <typename T> T ExpAxis<T>::back_transform(T t) const {
-  return this->low * std::exp(t * this->stepsize);
+template <typename T> void ExpAxis<T>::back_transform_n(T *t, size_t n) const {
+  for (size_t k = 0; k < n; ++k)
+    t[k] *= this->stepsize;
+  detail::exp_n(t, n);
+  for (size_t k = 0; k < n; ++k)
+    t[k] *= this->low;
 }
-template <typename T> T ExpAxis<T>::derive(T x) const {
-  return 1. / (x * this->stepsize);
+
+template <typename T> T ExpAxis<T>::double_derive(T x) const {
+  return -1. / (x * x * this->stepsize);
 }
 
-template <typename T> T ExpAxis<T>::back_derive(T t) const {
-  return this->low * this->stepsize * std::exp(t * this->stepsize);
+template <typename T> T ExpAxis<T>::back_double_derive(T t) const {
+  return this->low * this->stepsize * this->stepsize * std::exp(t * this->stepsize);
 }
 
 //
@@ -47,22 +82,32 @@ ExpM1Axis<T>::ExpM1Axis(T _low, T _high, T _stepsize) : Axis<T>(_low, _high, _st
 
 template <typename T>
 ExpM1Axis<T>::ExpM1Axis(T _low, T _high, size_t _nodes) : Axis<T>(_low, _high, 0.f) {
-  this->stepsize = (std::log1p(_high / _low) - M_LN2) / static_cast<T>(_nodes - 1);
+  this->stepsize = (std::log1p(_high / _low) - detail::ln2) / static_cast<T>(_nodes - 1);
 }
 
-template <typename T> T ExpM1Axis<T>::transform(T x) const {
-  return (std::log1p(x / this->low) - M_LN2) / this->stepsize;
+template <typename T> void ExpM1Axis<T>::transform_n(T *x, size_t n) const {
+  for (size_t k = 0; k < n; ++k)
+    x[k] /= this->low;
+  detail::log1p_n(x, n);
+  for (size_t k = 0; k < n; ++k)
+    x[k] = (x[k] - detail::ln2) / this->stepsize;
 }
 
-template <typename T> T ExpM1Axis<T>::back_transform(T t) const {
-  return this->low * std::expm1(t * this->stepsize + M_LN2);
+template <typename T> void ExpM1Axis<T>::back_transform_n(T *t, size_t n) const {
+  for (size_t k = 0; k < n; ++k)
+    t[k] = t[k] * this->stepsize + detail::ln2;
+  detail::expm1_n(t, n);
+  for (size_t k = 0; k < n; ++k)
+    t[k] *= this->low;
 }
-template <typename T> T ExpM1Axis<T>::derive(T x) const {
-  return 1. / (this->stepsize * (x + this->low));
+
+template <typename T> T ExpM1Axis<T>::double_derive(T x) const {
+  return -1. / (this->stepsize * (x + this->low) * (x + this->low));
 }
 
-template <typename T> T ExpM1Axis<T>::back_derive(T t) const {
-  return this->low * this->stepsize * std::exp(t * this->stepsize + M_LN2);
+template <typename T> T ExpM1Axis<T>::back_double_derive(T t) const {
+  return this->low * this->stepsize * this->stepsize *
+         std::exp(t * this->stepsize + detail::ln2);
 }
 
 //
@@ -77,16 +122,186 @@ LinAxis<T>::LinAxis(T _low, T _high, size_t _nodes) : Axis<T>(_low, _high, 0.f)
   this->stepsize = (_high - _low) / static_cast<T>(_nodes - 1);
 }
 
-template <typename T> T LinAxis<T>::transform(T x) const {
-  return (x - this->low) / this->stepsize;
+template <typename T> void LinAxis<T>::transform_n(T *x, size_t n) const {
+  for (size_t k = 0; k < n; ++k)
+    x[k] = transform(x[k]);
+}
+
+template <typename T> void LinAxis<T>::back_transform_n(T *x, size_t n) const {
+  for (size_t k = 0; k < n; ++k)
+    x[k] = back_transform(x[k]);
+}
+
+template <typename T> T LinAxis<T>::double_derive(T) const { return 0; }
+template <typename T> T LinAxis<T>::back_double_derive(T) const { return 0; }
+
+//
+// RefinedAxis
+//
+
+template <typename T>
+RefinedAxis<T>::RefinedAxis(std::unique_ptr<Axis<T>> _base)
+    : RefinedAxis(std::move(_base), {}) {}
+
+template <typename T>
+RefinedAxis<T>::RefinedAxis(std::unique_ptr<Axis<T>> _base,
+                            std::vector<unsigned int> _levels)
+    : Axis<T>(_base->GetLow(), _base->GetHigh(), _base->GetStepsize()),
+      base(std::move(_base)), levels_(std::move(_levels)) {
+  auto cells = base->required_nodes() - 1;
+  if (levels_.empty())
+    levels_.resize(cells, 0);
+  if (levels_.size() != cells)
+    throw std::invalid_argument("The levels do not match the cells of the base axis.");
+  update();
+}
+
+template <typename T> void RefinedAxis<T>::update() {
+  auto n = levels_.size();
+  auto cells = std::vector<T>(n);
+  for (size_t c = 0; c < n; ++c)
+    cells[c] = std::ldexp(T(1), static_cast<int>(levels_[c]));
+  first.assign(n + 1, 0);
+  slope.assign(n + 1, 0);
+  bump.assign(n, 0);
+  for (size_t c = 0; c < n; ++c)
+    first[c + 1] = first[c] + cells[c];
+  // the slope at a base node is the lower one of both cells, the bump makes up
+  // for the nodes the blended slope leaves out of the cell
+  slope[0] = cells[0];
+  slope[n] = cells[n - 1];
+  for (size_t c = 1; c < n; ++c)
+    slope[c] = std::min(cells[c - 1], cells[c]);
+  for (size_t c = 0; c < n; ++c)
+    bump[c] = cells[c] - (slope[c] + slope[c + 1]) / 2;
 }
 
-template <typename T> T LinAxis<T>::back_transform(T x) const {
-  return x * this->stepsize + this->low;
+//
+// Within a cell the slope of the map is
+//   d_c + (d_{c+1} - d_c) S(tau) + bump_c B(tau)
+// with the smoothstep S = 10 tau^3 - 15 tau^4 + 6 tau^5 and the bump
+// B = 140 tau^3 (1 - tau)^3, which integrates to one. The first and second
+// derivative of both vanish at the base nodes.
+//
+
+template <typename T> T RefinedAxis<T>::map(T t, T &d1, T &d2) const {
+  auto n = levels_.size();
+  d2 = 0;
+  if (t < 0) {
+    d1 = slope[0];
+    return slope[0] * t;
+  }
+  if (t >= n) {
+    d1 = slope[n];
+    return first[n] + slope[n] * (t - n);
+  }
+  auto c = static_cast<size_t>(t);
+  auto tau = t - c;
+  auto delta = slope[c + 1] - slope[c];
+  d1 = slope[c];
+  if (delta == 0 && bump[c] == 0)
+    return first[c] + slope[c] * tau;
+  auto t2 = tau * tau, t3 = t2 * tau;
+  auto rest = 1 - tau;
+  auto s = t3 * (10 + tau * (-15 + 6 * tau));
+  auto ds = 30 * t2 * rest * rest;
+  auto b = 140 * t3 * rest * rest * rest;
+  auto db = 420 * t2 * rest * rest * (1 - 2 * tau);
+  auto is = t2 * t2 * (T(2.5) + tau * (-3 + tau));
+  auto ib = t2 * t2 * (35 + tau * (-84 + tau * (70 - 20 * tau)));
+  d1 += delta * s + bump[c] * b;
+  d2 = delta * ds + bump[c] * db;
+  return first[c] + slope[c] * tau + delta * is + bump[c] * ib;
 }
 
-template <typename T> T LinAxis<T>::derive(T) const { return 1. / this->stepsize; }
-template <typename T> T LinAxis<T>::back_derive(T) const { return this->stepsize; }
+template <typename T> T RefinedAxis<T>::unmap(T u) const {
+  auto n = levels_.size();
+  if (u < 0)
+    return u / slope[0];
+  if (u >= first[n])
+    return n + (u - first[n]) / slope[n];
+  auto c = static_cast<size_t>(std::upper_bound(first.begin(), first.end(), u) -
+                               first.begin() - 1);
+  auto r = u - first[c];
+  if (slope[c] == slope[c + 1] && bump[c] == 0)
+    return c + r / slope[c];
+  // the map is monotone, Newton steps are kept within the bracket of the root
+  auto lo = T(0), hi = T(1);
+  auto tau = r / (first[c + 1] - first[c]);
+  for (int i = 0; i < 100; ++i) {
+    T d1, d2;
+    auto g = map(c + tau, d1, d2) - u;
+    if (g < 0)
+      lo = tau;
+    else
+      hi = tau;
+    auto next = tau - g / d1;
+    if (!(next > lo && next < hi))
+      next = (lo + hi) / 2;
+    if (std::abs(next - tau) <= 4 * std::numeric_limits<T>::epsilon())
+      return c + next;
+    tau = next;
+  }
+  return c + tau;
+}
+
+template <typename T> void RefinedAxis<T>::refine(std::vector<bool> const &cells) {
+  auto n = levels_.size();
+  auto raise = std::vector<bool>(n, false);
+  for (size_t i = 0; i < cells.size(); ++i)
+    if (cells[i])
+      raise[std::min(n - 1, static_cast<size_t>(unmap(i + T(0.5))))] = true;
+  for (size_t c = 0; c < n; ++c)
+    if (raise[c])
+      ++levels_[c];
+  for (auto balanced = false; !balanced;) {
+    balanced = true;
+    for (size_t c = 1; c < n; ++c) {
+      auto &lower = levels_[c - 1] < levels_[c] ? levels_[c - 1] : levels_[c];
+      if (lower + 1 < std::max(levels_[c - 1], levels_[c])) {
+        ++lower;
+        balanced = false;
+      }
+    }
+  }
+  update();
+}
+
+template <typename T> T RefinedAxis<T>::transform(T x) const {
+  T d1, d2;
+  return map(base->transform(x), d1, d2);
+}
+
+template <typename T> T RefinedAxis<T>::back_transform(T t) const {
+  return base->back_transform(unmap(t));
+}
+
+template <typename T> T RefinedAxis<T>::derive(T x) const {
+  T d1, d2;
+  map(base->transform(x), d1, d2);
+  return d1 * base->derive(x);
+}
+
+template <typename T> T RefinedAxis<T>::back_derive(T t) const {
+  auto b = unmap(t);
+  T d1, d2;
+  map(b, d1, d2);
+  return base->back_derive(b) / d1;
+}
+
+template <typename T> T RefinedAxis<T>::double_derive(T x) const {
+  T d1, d2;
+  map(base->transform(x), d1, d2);
+  auto dx = base->derive(x);
+  return d2 * dx * dx + d1 * base->double_derive(x);
+}
+
+template <typename T> T RefinedAxis<T>::back_double_derive(T t) const {
+  auto b = unmap(t);
+  T d1, d2;
+  map(b, d1, d2);
+  return base->back_double_derive(b) / (d1 * d1) - base->back_derive(b) * d2 / (d1 * d1 * d1);
+}
 
 namespace cubic_splines {
 template class Axis<double>;
@@ -97,4 +312,6 @@ template class ExpAxis<double>;
 template class ExpAxis<float>;
 template class ExpM1Axis<double>;
 template class ExpM1Axis<float>;
+template class RefinedAxis<double>;
+template class RefinedAxis<float>;
 } // namespace cubic_splines
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cubic_splines {
+namespace detail {
+
+/**
+ * @brief Uniform cubic B-spline basis functions, or their *d*-th derivative,
+ * of the four coefficients contributing to a cell at the relative cell
+ * coordinate `u`.
+ */
+template <typename T> inline void bspline_basis(T u, int d, T *b) {
+  auto s = 1 - u;
+  switch (d) {
+  case 0:
+    b[0] = s * s * s / 6;
+    b[1] = ((3 * u - 6) * u * u + 4) / 6;
+    b[2] = (((-3 * u + 3) * u + 3) * u + 1) / 6;
+    b[3] = u * u * u / 6;
+    break;
+  case 1:
+    b[0] = -s * s / 2;
+    b[1] = (3 * u - 4) * u / 2;
+    b[2] = ((-3 * u + 2) * u + 1) / 2;
+    b[3] = u * u / 2;
+    break;
+  default:
+    b[0] = s;
+    b[1] = 3 * u - 2;
+    b[2] = 1 - 3 * u;
+    b[3] = u;
+  }
+}
+
+/**
+ * @brief Cell of a uniform cubic B-spline with unit stepsize and the first
+ * node at zero containing `x`, the relative cell coordinate is written to `u`.
+ * Points out of range belong to the boundary cells.
+ */
+template <typename T> inline size_t bspline_locate(size_t n_nodes, T x, T &u) {
+  auto i = std::floor(x);
+  i = i < 0 ? T(0) : i;
+  i = i > T(n_nodes - 2) ? T(n_nodes - 2) : i;
+  u = x - i;
+  return static_cast<size_t>(i);
+}
+
+/**
+ * @brief Combine the four coefficients `c[0..3]` of a cell with the basis
+ * functions `b`.
+ */
+template <typename T> inline T bspline_combine(T const *c, T const *b) {
+  return c[0] * b[0] + c[1] * b[1] + c[2] * b[2] + c[3] * b[3];
+}
+
+/**
+ * @brief Evaluate the *d*-th derivative of a uniform cubic B-spline with unit
+ * stepsize and the first node at zero. Points out of range are extrapolated
+ * with the polynom of the boundary cell.
+ */
+template <typename T> inline T bspline_evaluate(T const *c, size_t n_nodes, T x, int d) {
+  T u;
+  auto k = bspline_locate(n_nodes, x, u);
+  T b[4];
+  bspline_basis(u, d, b);
+  return bspline_combine(c + k, b);
+}
+
+/**
+ * @brief Polynomial coefficients, ordered by increasing power of the relative
+ * cell coordinate, of the cell with the B-spline coefficients `b[0..3]`.
+ */
+template <typename T> inline void bspline_cell(T const *b, T *p) {
+  p[0] = (b[0] + 4 * b[1] + b[2]) / 6;
+  p[1] = (b[2] - b[0]) / 2;
+  p[2] = (b[0] - 2 * b[1] + b[2]) / 2;
+  p[3] = (b[3] - b[0]) / 6 + (b[1] - b[2]) / 2;
+}
+
+constexpr size_t pow4(size_t n) { return n == 0 ? 1 : 4 * pow4(n - 1); }
+
+/**
+ * @brief Contract the *4^N* coefficients around a cell, stored with the last
+ * dimension contiguous, with the four basis functions `b[d]` of every
+ * dimension.
+ */
+template <size_t N, typename T> inline T bspline_contract(T const *c, T const *const *b) {
+  constexpr auto M = pow4(N - 1);
+  T buf[M];
+  for (size_t k = 0; k < M; ++k)
+    buf[k] = c[4 * k] * b[N - 1][0] + c[4 * k + 1] * b[N - 1][1] +
+             c[4 * k + 2] * b[N - 1][2] + c[4 * k + 3] * b[N - 1][3];
+  auto m = M;
+  for (size_t d = N - 1; d-- > 0;) {
+    m /= 4;
+    for (size_t k = 0; k < m; ++k)
+      buf[k] = buf[4 * k] * b[d][0] + buf[4 * k + 1] * b[d][1] + buf[4 * k + 2] * b[d][2] +
+               buf[4 * k + 3] * b[d][3];
+  }
+  return buf[0];
+}
+
+/**
+ * @brief Coefficients of the uniform cubic B-spline with unit stepsize,
+ * interpolating the *n* values `y[k * stride]` with the given derivatives at
+ * the boundaries. Returns *n + 2* coefficients. A NaN derivative is estimated
+ * by the one-sided fourth order difference of the first or last five values.
+ * The system is solved on the values shifted by their mean to reduce the
+ * cancellation, the same way as in
+ * boost::math::interpolators::cardinal_cubic_b_spline.
+ */
+template <typename T>
+std::vector<T> bspline_coefficients(T const *y, size_t n, T d_low, T d_up,
+                                    size_t stride = 1) {
+  if (n < 5 && (std::isnan(d_low) || std::isnan(d_up)))
+    throw std::logic_error("Interpolation using a cubic b spline with derivatives "
+                           "estimated at the endpoints requires at least 5 points.");
+  if (n < 3)
+    throw std::logic_error("Interpolation using a cubic b spline requires at least 3 "
+                           "points.");
+  auto f = [y, stride](size_t k) { return y[k * stride]; };
+  if (std::isnan(d_low))
+    d_low = 4 * (f(1) + f(3) / 3) - (25 * f(0) / 3 + f(4)) / 4 - 3 * f(2);
+  if (std::isnan(d_up))
+    d_up = -4 * (f(n - 2) + f(n - 4) / 3) + (25 * f(n - 1) / 3 + f(n - 5)) / 4 +
+           3 * f(n - 3);
+
+  auto avg = T(0);
+  for (size_t k = 0; k < n; ++k) {
+    if (std::isnan(f(k)))
+      throw std::logic_error("The function to interpolate is a nan at index " +
+                             std::to_string(k) + ".");
+    avg += (f(k) - avg) / static_cast<T>(k + 1);
+  }
+
+  // tridiagonal system with the boundary derivatives in the first and last row
+  auto m = n + 2;
+  auto rhs = std::vector<T>(m);
+  auto super = std::vector<T>(m, 1);
+  rhs[0] = -2 * d_low;
+  rhs[m - 1] = -2 * d_up;
+  super[0] = 0;
+  for (size_t k = 1; k < m - 1; ++k)
+    rhs[k] = 6 * (f(k - 1) - avg);
+  super[1] = 0.5;
+  rhs[1] = (rhs[1] - rhs[0]) / 4;
+  for (size_t k = 2; k < m - 1; ++k) {
+    auto diagonal = 4 - super[k - 1];
+    rhs[k] = (rhs[k] - rhs[k - 1]) / diagonal;
+    super[k] /= diagonal;
+  }
+  auto final_subdiag = -super[m - 3];
+  rhs[m - 1] = (rhs[m - 1] - rhs[m - 3]) / final_subdiag;
+  auto final_diag = -1 / final_subdiag - super[m - 2];
+  rhs[m - 1] = rhs[m - 1] - rhs[m - 2];
+
+  auto c = std::vector<T>(m);
+  c[m - 1] = rhs[m - 1] / final_diag;
+  for (size_t k = m - 2; k > 0; --k)
+    c[k] = rhs[k] - super[k] * c[k + 1];
+  c[0] = c[2] + rhs[0];
+
+  // the basis functions sum up to one, the mean can be added to every
+  // coefficient
+  for (auto &ck : c)
+    ck += avg;
+  return c;
+}
+
+} // namespace detail
+} // namespace cubic_splines
@@ -0,0 +1,411 @@
+#include "detail/BicubicKernel.h"
+
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define CUBIC_SPLINES_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace cubic_splines {
+namespace detail {
+
+#ifdef CUBIC_SPLINES_X86_SIMD
+
+//
+// SSE4.2
+//
+
+namespace sse42 {
+#define CUBIC_SPLINES_TARGET __attribute__((target("sse4.2")))
+
+struct vint128 {
+  using vec = __m128i;
+  CUBIC_SPLINES_TARGET static vec set1(int a) { return _mm_set1_epi32(a); }
+  CUBIC_SPLINES_TARGET static vec add(vec a, vec b) { return _mm_add_epi32(a, b); }
+  CUBIC_SPLINES_TARGET static vec mullo(vec a, vec b) { return _mm_mullo_epi32(a, b); }
+  CUBIC_SPLINES_TARGET static vec and_(vec a, vec b) { return _mm_and_si128(a, b); }
+  CUBIC_SPLINES_TARGET static vec or_(vec a, vec b) { return _mm_or_si128(a, b); }
+  CUBIC_SPLINES_TARGET static vec sll(vec a, unsigned int n) {
+    return _mm_sll_epi32(a, _mm_cvtsi32_si128(static_cast<int>(n)));
+  }
+  CUBIC_SPLINES_TARGET static vec srl(vec a, unsigned int n) {
+    return _mm_srl_epi32(a, _mm_cvtsi32_si128(static_cast<int>(n)));
+  }
+};
+
+struct vdouble {
+  using value = double;
+  using storage = double;
+  using vec = __m128d;
+  using vint = vint128;
+  static constexpr size_t width = 2;
+  CUBIC_SPLINES_TARGET static vec load(double const *p) { return _mm_load_pd(p); }
+  CUBIC_SPLINES_TARGET static void store(double *p, vec a) { _mm_storeu_pd(p, a); }
+  CUBIC_SPLINES_TARGET static vec set1(double a) { return _mm_set1_pd(a); }
+  CUBIC_SPLINES_TARGET static vec sub(vec a, vec b) { return _mm_sub_pd(a, b); }
+  CUBIC_SPLINES_TARGET static vec fmadd(vec a, vec b, vec c) {
+    return _mm_add_pd(_mm_mul_pd(a, b), c);
+  }
+  CUBIC_SPLINES_TARGET static vec floor(vec a) { return _mm_floor_pd(a); }
+  CUBIC_SPLINES_TARGET static vec clamp(vec a, vec hi) {
+    return _mm_min_pd(_mm_max_pd(a, _mm_setzero_pd()), hi);
+  }
+  CUBIC_SPLINES_TARGET static __m128i to_int(vec a) { return _mm_cvttpd_epi32(a); }
+  CUBIC_SPLINES_TARGET static vec gather(double const *p, __m128i off) {
+    return _mm_set_pd(p[_mm_extract_epi32(off, 1)], p[_mm_cvtsi128_si32(off)]);
+  }
+};
+
+struct vfloat {
+  using value = float;
+  using storage = float;
+  using vec = __m128;
+  using vint = vint128;
+  static constexpr size_t width = 4;
+  CUBIC_SPLINES_TARGET static vec load(float const *p) { return _mm_load_ps(p); }
+  CUBIC_SPLINES_TARGET static void store(float *p, vec a) { _mm_storeu_ps(p, a); }
+  CUBIC_SPLINES_TARGET static vec set1(float a) { return _mm_set1_ps(a); }
+  CUBIC_SPLINES_TARGET static vec sub(vec a, vec b) { return _mm_sub_ps(a, b); }
+  CUBIC_SPLINES_TARGET static vec fmadd(vec a, vec b, vec c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+  }
+  CUBIC_SPLINES_TARGET static vec floor(vec a) { return _mm_floor_ps(a); }
+  CUBIC_SPLINES_TARGET static vec clamp(vec a, vec hi) {
+    return _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), hi);
+  }
+  CUBIC_SPLINES_TARGET static __m128i to_int(vec a) { return _mm_cvttps_epi32(a); }
+  CUBIC_SPLINES_TARGET static vec gather(float const *p, __m128i off) {
+    return _mm_set_ps(p[_mm_extract_epi32(off, 3)], p[_mm_extract_epi32(off, 2)],
+                      p[_mm_extract_epi32(off, 1)], p[_mm_cvtsi128_si32(off)]);
+  }
+};
+
+struct vdouble_float : vdouble {
+  using storage = float;
+  CUBIC_SPLINES_TARGET static vec gather(float const *p, __m128i off) {
+    return _mm_set_pd(p[_mm_extract_epi32(off, 1)], p[_mm_cvtsi128_si32(off)]);
+  }
+};
+
+#include "detail/BicubicKernel.inc"
+#undef CUBIC_SPLINES_TARGET
+} // namespace sse42
+
+//
+// AVX2
+//
+
+namespace avx2 {
+#define CUBIC_SPLINES_TARGET __attribute__((target("avx2,fma")))
+
+// The gathers and the AVX-512 operations are used in their masked forms with
+// a zero passthrough. The unmasked intrinsics pass an undefined vector, which
+// GCC reports as maybe uninitialized.
+
+struct vint128 {
+  using vec = __m128i;
+  CUBIC_SPLINES_TARGET static vec set1(int a) { return _mm_set1_epi32(a); }
+  CUBIC_SPLINES_TARGET static vec add(vec a, vec b) { return _mm_add_epi32(a, b); }
+  CUBIC_SPLINES_TARGET static vec mullo(vec a, vec b) { return _mm_mullo_epi32(a, b); }
+  CUBIC_SPLINES_TARGET static vec and_(vec a, vec b) { return _mm_and_si128(a, b); }
+  CUBIC_SPLINES_TARGET static vec or_(vec a, vec b) { return _mm_or_si128(a, b); }
+  CUBIC_SPLINES_TARGET static vec sll(vec a, unsigned int n) {
+    return _mm_sll_epi32(a, _mm_cvtsi32_si128(static_cast<int>(n)));
+  }
+  CUBIC_SPLINES_TARGET static vec srl(vec a, unsigned int n) {
+    return _mm_srl_epi32(a, _mm_cvtsi32_si128(static_cast<int>(n)));
+  }
+};
+
+struct vint256 {
+  using vec = __m256i;
+  CUBIC_SPLINES_TARGET static vec set1(int a) { return _mm256_set1_epi32(a); }
+  CUBIC_SPLINES_TARGET static vec add(vec a, vec b) { return _mm256_add_epi32(a, b); }
+  CUBIC_SPLINES_TARGET static vec mullo(vec a, vec b) { return _mm256_mullo_epi32(a, b); }
+  CUBIC_SPLINES_TARGET static vec and_(vec a, vec b) { return _mm256_and_si256(a, b); }
+  CUBIC_SPLINES_TARGET static vec or_(vec a, vec b) { return _mm256_or_si256(a, b); }
+  CUBIC_SPLINES_TARGET static vec sll(vec a, unsigned int n) {
+    return _mm256_sll_epi32(a, _mm_cvtsi32_si128(static_cast<int>(n)));
+  }
+  CUBIC_SPLINES_TARGET static vec srl(vec a, unsigned int n) {
+    return _mm256_srl_epi32(a, _mm_cvtsi32_si128(static_cast<int>(n)));
+  }
+};
+
+struct vdouble {
+  using value = double;
+  using storage = double;
+  using vec = __m256d;
+  using vint = vint128;
+  static constexpr size_t width = 4;
+  CUBIC_SPLINES_TARGET static vec all() {
+    return _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+  }
+  CUBIC_SPLINES_TARGET static vec load(double const *p) { return _mm256_load_pd(p); }
+  CUBIC_SPLINES_TARGET static void store(double *p, vec a) { _mm256_storeu_pd(p, a); }
+  CUBIC_SPLINES_TARGET static vec set1(double a) { return _mm256_set1_pd(a); }
+  CUBIC_SPLINES_TARGET static vec sub(vec a, vec b) { return _mm256_sub_pd(a, b); }
+  CUBIC_SPLINES_TARGET static vec fmadd(vec a, vec b, vec c) {
+    return _mm256_fmadd_pd(a, b, c);
+  }
+  CUBIC_SPLINES_TARGET static vec floor(vec a) { return _mm256_floor_pd(a); }
+  CUBIC_SPLINES_TARGET static vec clamp(vec a, vec hi) {
+    return _mm256_min_pd(_mm256_max_pd(a, _mm256_setzero_pd()), hi);
+  }
+  CUBIC_SPLINES_TARGET static __m128i to_int(vec a) { return _mm256_cvttpd_epi32(a); }
+  CUBIC_SPLINES_TARGET static vec gather(double const *p, __m128i off) {
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), p, off, all(), 8);
+  }
+};
+
+struct vfloat {
+  using value = float;
+  using storage = float;
+  using vec = __m256;
+  using vint = vint256;
+  static constexpr size_t width = 8;
+  CUBIC_SPLINES_TARGET static vec all() {
+    return _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+  }
+  CUBIC_SPLINES_TARGET static vec load(float const *p) { return _mm256_load_ps(p); }
+  CUBIC_SPLINES_TARGET static void store(float *p, vec a) { _mm256_storeu_ps(p, a); }
+  CUBIC_SPLINES_TARGET static vec set1(float a) { return _mm256_set1_ps(a); }
+  CUBIC_SPLINES_TARGET static vec sub(vec a, vec b) { return _mm256_sub_ps(a, b); }
+  CUBIC_SPLINES_TARGET static vec fmadd(vec a, vec b, vec c) {
+    return _mm256_fmadd_ps(a, b, c);
+  }
+  CUBIC_SPLINES_TARGET static vec floor(vec a) { return _mm256_floor_ps(a); }
+  CUBIC_SPLINES_TARGET static vec clamp(vec a, vec hi) {
+    return _mm256_min_ps(_mm256_max_ps(a, _mm256_setzero_ps()), hi);
+  }
+  CUBIC_SPLINES_TARGET static __m256i to_int(vec a) { return _mm256_cvttps_epi32(a); }
+  CUBIC_SPLINES_TARGET static vec gather(float const *p, __m256i off) {
+    return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), p, off, all(), 4);
+  }
+};
+
+struct vdouble_float : vdouble {
+  using storage = float;
+  CUBIC_SPLINES_TARGET static vec gather(float const *p, __m128i off) {
+    auto all = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    return _mm256_cvtps_pd(_mm_mask_i32gather_ps(_mm_setzero_ps(), p, off, all, 4));
+  }
+};
+
+#include "detail/BicubicKernel.inc"
+#undef CUBIC_SPLINES_TARGET
+} // namespace avx2
+
+//
+// AVX-512
+//
+
+namespace avx512 {
+#define CUBIC_SPLINES_TARGET __attribute__((target("avx512f")))
+
+struct vint256 {
+  using vec = __m256i;
+  CUBIC_SPLINES_TARGET static vec set1(int a) { return _mm256_set1_epi32(a); }
+  CUBIC_SPLINES_TARGET static vec add(vec a, vec b) { return _mm256_add_epi32(a, b); }
+  CUBIC_SPLINES_TARGET static vec mullo(vec a, vec b) { return _mm256_mullo_epi32(a, b); }
+  CUBIC_SPLINES_TARGET static vec and_(vec a, vec b) { return _mm256_and_si256(a, b); }
+  CUBIC_SPLINES_TARGET static vec or_(vec a, vec b) { return _mm256_or_si256(a, b); }
+  CUBIC_SPLINES_TARGET static vec sll(vec a, unsigned int n) {
+    return _mm256_sll_epi32(a, _mm_cvtsi32_si128(static_cast<int>(n)));
+  }
+  CUBIC_SPLINES_TARGET static vec srl(vec a, unsigned int n) {
+    return _mm256_srl_epi32(a, _mm_cvtsi32_si128(static_cast<int>(n)));
+  }
+};
+
+struct vint512 {
+  using vec = __m512i;
+  static constexpr __mmask16 all = 0xffff;
+  CUBIC_SPLINES_TARGET static vec set1(int a) { return _mm512_set1_epi32(a); }
+  CUBIC_SPLINES_TARGET static vec add(vec a, vec b) { return _mm512_add_epi32(a, b); }
+  CUBIC_SPLINES_TARGET static vec mullo(vec a, vec b) { return _mm512_mullo_epi32(a, b); }
+  CUBIC_SPLINES_TARGET static vec and_(vec a, vec b) { return _mm512_and_si512(a, b); }
+  CUBIC_SPLINES_TARGET static vec or_(vec a, vec b) { return _mm512_or_si512(a, b); }
+  CUBIC_SPLINES_TARGET static vec sll(vec a, unsigned int n) {
+    return _mm512_maskz_sll_epi32(all, a, _mm_cvtsi32_si128(static_cast<int>(n)));
+  }
+  CUBIC_SPLINES_TARGET static vec srl(vec a, unsigned int n) {
+    return _mm512_maskz_srl_epi32(all, a, _mm_cvtsi32_si128(static_cast<int>(n)));
+  }
+};
+
+struct vdouble {
+  using value = double;
+  using storage = double;
+  using vec = __m512d;
+  using vint = vint256;
+  static constexpr size_t width = 8;
+  static constexpr __mmask8 all = 0xff;
+  CUBIC_SPLINES_TARGET static vec load(double const *p) { return _mm512_load_pd(p); }
+  CUBIC_SPLINES_TARGET static void store(double *p, vec a) { _mm512_storeu_pd(p, a); }
+  CUBIC_SPLINES_TARGET static vec set1(double a) { return _mm512_set1_pd(a); }
+  CUBIC_SPLINES_TARGET static vec sub(vec a, vec b) { return _mm512_sub_pd(a, b); }
+  CUBIC_SPLINES_TARGET static vec fmadd(vec a, vec b, vec c) {
+    return _mm512_fmadd_pd(a, b, c);
+  }
+  CUBIC_SPLINES_TARGET static vec floor(vec a) {
+    return _mm512_maskz_roundscale_pd(all, a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  }
+  CUBIC_SPLINES_TARGET static vec clamp(vec a, vec hi) {
+    return _mm512_maskz_min_pd(all, _mm512_maskz_max_pd(all, a, _mm512_setzero_pd()), hi);
+  }
+  CUBIC_SPLINES_TARGET static __m256i to_int(vec a) {
+    return _mm512_maskz_cvttpd_epi32(all, a);
+  }
+  CUBIC_SPLINES_TARGET static vec gather(double const *p, __m256i off) {
+    return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), all, off, p, 8);
+  }
+};
+
+struct vfloat {
+  using value = float;
+  using storage = float;
+  using vec = __m512;
+  using vint = vint512;
+  static constexpr size_t width = 16;
+  static constexpr __mmask16 all = 0xffff;
+  CUBIC_SPLINES_TARGET static vec load(float const *p) { return _mm512_load_ps(p); }
+  CUBIC_SPLINES_TARGET static void store(float *p, vec a) { _mm512_storeu_ps(p, a); }
+  CUBIC_SPLINES_TARGET static vec set1(float a) { return _mm512_set1_ps(a); }
+  CUBIC_SPLINES_TARGET static vec sub(vec a, vec b) { return _mm512_sub_ps(a, b); }
+  CUBIC_SPLINES_TARGET static vec fmadd(vec a, vec b, vec c) {
+    return _mm512_fmadd_ps(a, b, c);
+  }
+  CUBIC_SPLINES_TARGET static vec floor(vec a) {
+    return _mm512_maskz_roundscale_ps(all, a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  }
+  CUBIC_SPLINES_TARGET static vec clamp(vec a, vec hi) {
+    return _mm512_maskz_min_ps(all, _mm512_maskz_max_ps(all, a, _mm512_setzero_ps()), hi);
+  }
+  CUBIC_SPLINES_TARGET static __m512i to_int(vec a) {
+    return _mm512_maskz_cvttps_epi32(all, a);
+  }
+  CUBIC_SPLINES_TARGET static vec gather(float const *p, __m512i off) {
+    return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), all, off, p, 4);
+  }
+};
+
+struct vdouble_float : vdouble {
+  using storage = float;
+  CUBIC_SPLINES_TARGET static vec gather(float const *p, __m256i off) {
+    auto all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    return _mm512_maskz_cvtps_pd(
+        vdouble::all, _mm256_mask_i32gather_ps(_mm256_setzero_ps(), p, off, all, 4));
+  }
+};
+
+#include "detail/BicubicKernel.inc"
+#undef CUBIC_SPLINES_TARGET
+} // namespace avx512
+
+template <typename T, typename S> struct simd_traits;
+
+template <> struct simd_traits<double, double> {
+  using sse42 = sse42::vdouble;
+  using avx2 = avx2::vdouble;
+  using avx512 = avx512::vdouble;
+};
+
+template <> struct simd_traits<float, float> {
+  using sse42 = sse42::vfloat;
+  using avx2 = avx2::vfloat;
+  using avx512 = avx512::vfloat;
+};
+
+template <> struct simd_traits<double, float> {
+  using sse42 = sse42::vdouble_float;
+  using avx2 = avx2::vdouble_float;
+  using avx512 = avx512::vdouble_float;
+};
+
+SimdLevel simd_level() {
+  static auto const level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+      return SimdLevel::avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return SimdLevel::avx2;
+    if (__builtin_cpu_supports("sse4.2"))
+      return SimdLevel::sse42;
+    return SimdLevel::scalar;
+  }();
+  return level;
+}
+
+#else
+
+SimdLevel simd_level() { return SimdLevel::scalar; }
+
+#endif
+
+CellIndex::CellIndex(Order _order, int _s0, int _s1)
+    : order(_order), s0(_s0), s1(_s1) {
+  auto side = 1u << tile_bits;
+  tiles0 = (static_cast<unsigned int>(s0) + side - 1) / side;
+  auto bits0 = 0u, bits1 = 0u;
+  while ((1 << bits0) < s0)
+    ++bits0;
+  while ((1 << bits1) < s1)
+    ++bits1;
+  common_bits = std::min(bits0, bits1);
+}
+
+size_t CellIndex::cells() const {
+  switch (order) {
+  case Order::tiled: {
+    auto side = 1u << tile_bits;
+    auto tiles1 = (static_cast<size_t>(s1) + side - 1) / side;
+    return (tiles0 * tiles1) << (2 * tile_bits);
+  }
+  case Order::morton:
+    // the index of the last cell is the largest one
+    return s0 > 0 && s1 > 0 ? (*this)(s0 - 1, s1 - 1) + 1 : 0;
+  default:
+    return static_cast<size_t>(s0) * s1;
+  }
+}
+
+template <typename T, typename S>
+void bicubic_kernel(SimdLevel level, S const *c, CellIndex const &index, T const *x,
+                    T *out, size_t n) {
+  size_t k = 0;
+#ifdef CUBIC_SPLINES_X86_SIMD
+  using traits = simd_traits<T, S>;
+  switch (level) {
+  case SimdLevel::avx512:
+    k = avx512::bicubic<typename traits::avx512>(c, index, x, out, n);
+    break;
+  case SimdLevel::avx2:
+    k = avx2::bicubic<typename traits::avx2>(c, index, x, out, n);
+    break;
+  case SimdLevel::sse42:
+    k = sse42::bicubic<typename traits::sse42>(c, index, x, out, n);
+    break;
+  case SimdLevel::scalar:
+    break;
+  }
+#else
+  (void)level;
+#endif
+  for (; k < n; ++k) {
+    auto n0 = calculate_node(x[2 * k], index.s0);
+    auto n1 = calculate_node(x[2 * k + 1], index.s1);
+    out[k] = horner(c + 16 * index(n0, n1), x[2 * k] - n0, x[2 * k + 1] - n1);
+  }
+}
+
+template void bicubic_kernel<double>(SimdLevel, double const *, CellIndex const &,
+                                     double const *, double *, size_t);
+template void bicubic_kernel<float>(SimdLevel, float const *, CellIndex const &,
+                                    float const *, float *, size_t);
+template void bicubic_kernel<double, float>(SimdLevel, float const *, CellIndex const &,
+                                            double const *, double *, size_t);
+
+} // namespace detail
+} // namespace cubic_splines
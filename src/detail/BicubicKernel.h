@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+namespace cubic_splines {
+namespace detail {
+
+template <typename T> auto calculate_node(T val, unsigned int n_max) {
+  auto n = std::floor(val);
+  if (n < 0)
+    return 0u;
+  if (static_cast<unsigned int>(n) > n_max - 2u)
+    return n_max - 2u;
+  return static_cast<unsigned int>(n);
+}
+
+/**
+ * @brief Evaluate the bicubic polynom stored in row major order `c[4 * i + j]`
+ * for the relative cell coordinates `u` and `v` with a Horner scheme. The
+ * coefficients might be stored with a lower precision than the evaluation.
+ */
+template <typename T, typename S> inline T horner(S const *c, T u, T v) {
+  T r[4];
+  for (size_t i = 0; i < 4; ++i)
+    r[i] = ((T(c[4 * i + 3]) * v + T(c[4 * i + 2])) * v + T(c[4 * i + 1])) * v +
+           T(c[4 * i]);
+  return ((r[3] * u + r[2]) * u + r[1]) * u + r[0];
+}
+
+/**
+ * @brief Derivative of the bicubic polynom stored in row major order
+ * `c[4 * i + j]` with respect to the relative cell coordinates. The order of
+ * the derivative in each coordinate is given by `du` and `dv`.
+ */
+template <typename T, typename S>
+inline T horner_derivative(S const *c, T u, T v, int du, int dv) {
+  T pu[4] = {0, 0, 0, 0}, pv[4] = {0, 0, 0, 0};
+  T xu = 1, xv = 1;
+  for (int i = 0; i < 4; ++i) {
+    // derivative of the monomials, scaled by the falling factorial
+    if (i >= du) {
+      pu[i] = xu;
+      for (int k = 0; k < du; ++k)
+        pu[i] *= i - k;
+      xu *= u;
+    }
+    if (i >= dv) {
+      pv[i] = xv;
+      for (int k = 0; k < dv; ++k)
+        pv[i] *= i - k;
+      xv *= v;
+    }
+  }
+  T res = 0;
+  for (int i = 0; i < 4; ++i)
+    for (int j = 0; j < 4; ++j)
+      res += T(c[4 * i + j]) * pu[i] * pv[j];
+  return res;
+}
+
+/**
+ * @brief Position of the cells in a coefficient table of *s0 x s1* cells. With
+ * the *tiled* order square tiles of `2^tile_bits` cells per side are stored
+ * contiguously, with the *morton* order the cells follow the Z-order curve.
+ * Both keep cells which are close in the plane close in memory, unused cells
+ * of the padding to full tiles or powers of two stay zero.
+ */
+struct CellIndex {
+  enum class Order { column_major, tiled, morton };
+
+  static constexpr unsigned int tile_bits = 3;
+
+  Order order = Order::column_major;
+  int s0 = 0, s1 = 0;
+  unsigned int tiles0 = 0;      // tiles along the first axis
+  unsigned int common_bits = 0; // interleaved bits of the morton order
+
+  CellIndex() = default;
+  CellIndex(Order, int, int);
+
+  /**
+   * @brief Number of cells including the padding.
+   */
+  size_t cells() const;
+
+  // distribute the lower 16 bits to the even bits
+  static unsigned int spread(unsigned int a) {
+    a = (a | (a << 8)) & 0x00ff00ffu;
+    a = (a | (a << 4)) & 0x0f0f0f0fu;
+    a = (a | (a << 2)) & 0x33333333u;
+    return (a | (a << 1)) & 0x55555555u;
+  }
+
+  size_t operator()(unsigned int n0, unsigned int n1) const {
+    switch (order) {
+    case Order::tiled: {
+      constexpr unsigned int mask = (1u << tile_bits) - 1u;
+      auto tile = (n0 >> tile_bits) + static_cast<size_t>(tiles0) * (n1 >> tile_bits);
+      return (tile << (2 * tile_bits)) + (((n1 & mask) << tile_bits) | (n0 & mask));
+    }
+    case Order::morton: {
+      auto mask = (1u << common_bits) - 1u;
+      // the remaining bits of the longer axis are appended
+      auto high = static_cast<size_t>((n0 >> common_bits) + (n1 >> common_bits));
+      return (high << (2 * common_bits)) | spread(n0 & mask) | (spread(n1 & mask) << 1);
+    }
+    default:
+      return n0 + static_cast<size_t>(s0) * n1;
+    }
+  }
+};
+
+/**
+ * @brief Instruction set extensions the bicubic batch kernel is available for.
+ */
+enum class SimdLevel { scalar, sse42, avx2, avx512 };
+
+/**
+ * @brief Highest instruction set extension supported by the executing CPU.
+ * The CPU is only queried on the first call.
+ */
+SimdLevel simd_level();
+
+/**
+ * @brief Evaluate *n* points of a bicubic coefficient table with cells of 16
+ * coefficients, stored in the order given by the index. The coordinates of
+ * the *k*-th point are expected at `x[2 * k]` and `x[2 * k + 1]`. The cell
+ * coefficients of several points are gathered at once, converted from the
+ * storage type *S* and the polynomials are evaluated in the lanes of the
+ * requested instruction set. Levels which are not compiled in fall back to the
+ * scalar evaluation.
+ */
+template <typename T, typename S = T>
+void bicubic_kernel(SimdLevel level, S const *c, CellIndex const &index, T const *x,
+                    T *out, size_t n);
+
+} // namespace detail
+} // namespace cubic_splines
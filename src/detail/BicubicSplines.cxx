@@ -1,297 +1,1234 @@
 #include "CubicInterpolation/BicubicSplines.h"
+#include "CubicInterpolation/Executor.h"
 #include "CubicInterpolation/InterpolantBuilder.h"
+#include "detail/BicubicKernel.h"
+#include "detail/Checkpoint.h"
+#include "detail/FiniteDifference.h"
+#include "detail/MappedTable.h"
+#include "detail/Sampling.h"
+#include "detail/Statistics.h"
+#include "detail/TileCache.h"
+#include "detail/TileFile.h"
 
 #include <Eigen/Dense>
-#include <boost/math/differentiation/finite_difference.hpp>
+#include <algorithm>
+#include <atomic>
 #include <boost/math/interpolators/cardinal_cubic_b_spline.hpp>
 #include <boost/serialization/access.hpp>
+#include <boost/serialization/version.hpp>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
 
-#include <chrono>
-#include <iostream>
-
 namespace cubic_splines {
-namespace detail {
 
-template <typename T> auto calculate_node(T val, unsigned int n_max) {
-  auto n = std::floor(val);
-  if (n < 0)
-    return 0u;
-  if (static_cast<unsigned int>(n) > n_max - 2u)
-    return n_max - 2u;
-  return static_cast<unsigned int>(n);
-}
+template <typename T, typename S> struct BicubicSplines<T, S>::RuntimeData {
+  using MatrixX = ::Eigen::Matrix<S, ::Eigen::Dynamic, ::Eigen::Dynamic>;
+  using Matrix4 = ::Eigen::Matrix<T, 4, 4>;
 
-template <typename T> auto exponent_vector(T x) {
-  auto x_vec = ::Eigen::Matrix<T, 4, 1>(4);
-  for (size_t i = 0; i < 4; ++i) {
-    x_vec(i) = 1;
-    for (size_t j = 1; j <= i; ++j)
-      x_vec(i) *= x;
+  // number of polynomial coefficients per cell
+  static constexpr size_t n_coeff = 16;
+
+  // values per node record, ordered as y, dydx1, dydx2 and d2ydx1dx2
+  static constexpr size_t n_fields = 4;
+
+  Layout layout = Layout::matrices;
+  std::array<long int, 2> size = {0, 0};
+  detail::CellIndex index;
+  MatrixX y, dydx1, dydx2, d2ydx1dx2;
+  std::vector<S> coefficients;
+  std::vector<S> nodes;
+  // cubic Hermite basis, the polynomial of a cell is m^T * nodes * m
+  static Matrix4 const &basis() {
+    static auto const b =
+        (Matrix4() << 1, 0, -3, 2, 0, 0, 3, -2, 0, 1, -2, 1, 0, 0, -1, 1).finished();
+    return b;
   }
-  return x_vec;
-}
-} // namespace detail
 
-namespace detail {}
+  Matrix4 m = basis();
 
-template <typename T> struct BicubicSplines<T>::RuntimeData {
-  using MatrixX = ::Eigen::Matrix<T, ::Eigen::Dynamic, ::Eigen::Dynamic>;
-  using Matrix4 = ::Eigen::Matrix<T, 4, 4>;
+  // cells per side of the tiles of lazy and out-of-core tables
+  static constexpr long int tile_cells = 32;
 
-  MatrixX y, dydx1, dydx2, d2ydx1dx2;
-  Matrix4 m =
-      (Matrix4() << 1, 0, -3, 2, 0, 0, 3, -2, 0, 1, -2, 1, 0, 0, -1, 1).finished();
+  struct Lazy;
+  std::shared_ptr<Lazy> lazy; // tiles sampled on demand, see Lazy
 
-  RuntimeData() = default;
+  struct Paged;
+  std::shared_ptr<Paged> paged; // tiles read from disk on demand, see Paged
 
-  RuntimeData(size_t n1, size_t n2)
-      : y(n1, n2), dydx1(n1, n2), dydx2(n1, n2), d2ydx1dx2(n1, n2){};
+  // node records mapped from the table file, used instead of nodes
+  std::shared_ptr<detail::MappedTable<S> const> mapping;
 
+  RuntimeData() = default;
+
+  /**
+   * @brief Take over the node matrices, which are rounded to the storage
+   * precision.
+   */
   template <typename T1>
-  RuntimeData(T1 &&_y, T1 &&_dydx1, T1 &&_dydx2, T1 &&_d2ydx1dx2)
-      : y(std::forward<T1>(_y)), dydx1(std::forward<T1>(_dydx1)),
-        dydx2(std::forward<T1>(_dydx2)), d2ydx1dx2(std::forward<T1>(_d2ydx1dx2)){};
+  RuntimeData(T1 const &_y, T1 const &_dydx1, T1 const &_dydx2, T1 const &_d2ydx1dx2)
+      : size{static_cast<long int>(_y.rows()), static_cast<long int>(_y.cols())},
+        index(detail::CellIndex::Order::column_major, size[0], size[1]),
+        y(_y.template cast<S>()), dydx1(_dydx1.template cast<S>()),
+        dydx2(_dydx2.template cast<S>()), d2ydx1dx2(_d2ydx1dx2.template cast<S>()){};
+
+  /**
+   * @brief Take over the interleaved node records in column major order.
+   */
+  RuntimeData(std::array<long int, 2> _size, std::vector<S> _nodes)
+      : layout(Layout::nodes), size(_size),
+        index(detail::CellIndex::Order::column_major, size[0], size[1]),
+        nodes(std::move(_nodes)){};
+
+  /**
+   * @brief Take over lazily built tables.
+   */
+  RuntimeData(std::shared_ptr<Lazy> _lazy)
+      : layout(Layout::coefficients), size(_lazy->grid.size), lazy(std::move(_lazy)){};
+
+  /**
+   * @brief Use the node records of a mapped table file in place. If they have
+   * to be converted, they are copied.
+   */
+  RuntimeData(std::shared_ptr<detail::MappedTable<S> const> _mapping)
+      : layout(Layout::nodes), size(_mapping->size()),
+        index(detail::CellIndex::Order::column_major, size[0], size[1]),
+        mapping(std::move(_mapping)) {
+    if (!mapping->in_place()) {
+      nodes = mapping->copy();
+      mapping.reset();
+    }
+  }
+
+  /**
+   * @brief Take over out-of-core tables.
+   */
+  RuntimeData(std::shared_ptr<Paged> _paged)
+      : layout(Layout::nodes), size(_paged->file.grid().size), paged(std::move(_paged)){};
+
+  template <typename T1> static auto to_vector(T1 m) {
+    using Scalar = typename T1::Scalar;
+    return ::std::vector<Scalar>(m.data(), m.data() + m.rows() * m.cols());
+  }
+
+  auto get_dimensions() const { return size; }
+
+  /**
+   * @brief Polynomial coefficients of the cell starting at node (n0, n1).
+   */
+  inline S const *cell(unsigned int n0, unsigned int n1) const {
+    return coefficients.data() + n_coeff * index(n0, n1);
+  }
+
+  // stored coefficients are used in place if they have the evaluation precision
+  static T const *convert(T const *c, std::array<T, n_coeff> &) { return c; }
+
+  template <typename S1>
+  static T const *convert(S1 const *c, std::array<T, n_coeff> &buffer) {
+    std::copy(c, c + n_coeff, buffer.begin());
+    return buffer.data();
+  }
+
+  /**
+   * @brief Record of the node (n0, n1) in the interleaved layout.
+   */
+  inline S const *node(unsigned int n0, unsigned int n1) const {
+    return records() + n_fields * (n0 + static_cast<size_t>(size[0]) * n1);
+  }
+
+  S const *records() const { return mapping ? mapping->records() : nodes.data(); }
+
+  /**
+   * @brief Polynomial coefficients of the cell starting at node (n0, n1). With
+   * the matrices and nodes layout or a lower storage precision they are
+   * written into the buffer.
+   */
+  inline T const *cell(unsigned int n0, unsigned int n1,
+                       std::array<T, n_coeff> &buffer) const {
+    if (lazy)
+      return convert(lazy->cell(n0, n1), buffer);
+    if (paged)
+      return paged->cell(n0, n1, buffer);
+    if (layout == Layout::coefficients)
+      return convert(cell(n0, n1), buffer);
+    auto temp = Matrix4();
+    if (layout == Layout::nodes) {
+      hermite(node(n0, n1), n_fields * size[0], temp);
+    } else {
+      temp.template block<2, 2>(0, 0) = y.block(n0, n1, 2, 2).template cast<T>();
+      temp.template block<2, 2>(2, 0) = dydx1.block(n0, n1, 2, 2).template cast<T>();
+      temp.template block<2, 2>(0, 2) = dydx2.block(n0, n1, 2, 2).template cast<T>();
+      temp.template block<2, 2>(2, 2) =
+          d2ydx1dx2.block(n0, n1, 2, 2).template cast<T>();
+    }
+    Matrix4 a = m.transpose() * (temp * m);
+    for (size_t k = 0; k < 4; ++k)
+      for (size_t l = 0; l < 4; ++l)
+        buffer[4 * k + l] = a(k, l);
+    return buffer.data();
+  }
+
+  /**
+   * @brief Gather the node values and derivatives of a cell from the records.
+   * The records of a cell are two pairs of neighbouring nodes, the first
+   * record is `r` and the next pair follows after `stride` values.
+   */
+  static void hermite(S const *r, size_t stride, Matrix4 &temp) {
+    for (size_t l = 0; l < 2; ++l) {
+      auto p = r + stride * l;
+      for (size_t k = 0; k < 2; ++k, p += n_fields) {
+        temp(k, l) = p[0];
+        temp(k + 2, l) = p[1];
+        temp(k, l + 2) = p[2];
+        temp(k + 2, l + 2) = p[3];
+      }
+    }
+  }
+
+  /**
+   * @brief Calculate the polynomial coefficients of every cell. A cell is
+   * stored for every node, the cells of the last row and column are never
+   * evaluated but keep the node values exact to restore the matrices.
+   */
+  void compute_coefficients() {
+    coefficients.assign(n_coeff * index.cells(), 0);
+    auto temp = Matrix4();
+    for (long int n1 = 0; n1 < size[1]; ++n1) {
+      for (long int n0 = 0; n0 < size[0]; ++n0) {
+        long int i[2] = {n0, std::min(n0 + 1, size[0] - 1)};
+        long int j[2] = {n1, std::min(n1 + 1, size[1] - 1)};
+        for (size_t k = 0; k < 2; ++k) {
+          for (size_t l = 0; l < 2; ++l) {
+            temp(k, l) = y(i[k], j[l]);
+            temp(k + 2, l) = dydx1(i[k], j[l]);
+            temp(k, l + 2) = dydx2(i[k], j[l]);
+            temp(k + 2, l + 2) = d2ydx1dx2(i[k], j[l]);
+          }
+        }
+        cell_polynomial(temp, coefficients.data() + n_coeff * index(n0, n1));
+      }
+    }
+  }
 
-  template <typename T1> static ::std::vector<T> to_vector(T1 m) {
-    return ::std::vector<T>(m.data(), m.data() + m.rows() * m.cols());
+  /**
+   * @brief Write the polynomial coefficients of a cell with the node values
+   * and derivatives in temp to `c[4 * i + j]`.
+   */
+  template <typename S1> static void cell_polynomial(Matrix4 const &temp, S1 *c) {
+    auto const &b = basis();
+    Matrix4 a = b.transpose() * (temp * b);
+    for (size_t k = 0; k < 4; ++k)
+      for (size_t l = 0; l < 4; ++l)
+        c[4 * k + l] = a(k, l);
   }
 
-  auto get_dimensions() const {
-    return std::array<long int, 2>{static_cast<long int>(y.rows()),
-                                   static_cast<long int>(y.cols())};
+  /**
+   * @brief Restore a node matrix from the coefficients or the node records.
+   * The constant, linear and mixed linear coefficients of a cell are the node
+   * value and its derivatives, so the values are reproduced exactly.
+   */
+  MatrixX node_matrix(size_t field) const {
+    static constexpr size_t offset[n_fields] = {0, 4, 1, 5};
+    auto mat = MatrixX(size[0], size[1]);
+    for (long int n1 = 0; n1 < size[1]; ++n1)
+      for (long int n0 = 0; n0 < size[0]; ++n0)
+        mat(n0, n1) = layout == Layout::nodes ? node(n0, n1)[field]
+                                              : cell(n0, n1)[offset[field]];
+    return mat;
+  }
+
+  /**
+   * @brief Interleave the node matrices into records.
+   */
+  static std::vector<S> interleave(MatrixX const &_y, MatrixX const &_dydx1,
+                                   MatrixX const &_dydx2, MatrixX const &_d2ydx1dx2) {
+    auto records = std::vector<S>(n_fields * _y.size());
+    for (long int k = 0; k < _y.size(); ++k) {
+      records[n_fields * k] = _y(k);
+      records[n_fields * k + 1] = _dydx1(k);
+      records[n_fields * k + 2] = _dydx2(k);
+      records[n_fields * k + 3] = _d2ydx1dx2(k);
+    }
+    return records;
+  }
+
+  /**
+   * @brief Bytes of the tables of all layouts.
+   */
+  size_t memory() const {
+    auto values = y.size() + dydx1.size() + dydx2.size() + d2ydx1dx2.size() +
+                  coefficients.capacity() + nodes.capacity();
+    return sizeof(S) * static_cast<size_t>(values);
+  }
+
+  /**
+   * @brief Convert the tables into the requested memory layout and cell order
+   * and release the memory which is not required anymore. The node matrices
+   * are the intermediate format between the layouts. Returns the peak memory
+   * of the conversion.
+   */
+  size_t set_layout(Layout _layout, CellOrder order = CellOrder::column_major) {
+    if (lazy || paged)
+      return memory();
+    // both enumerations list the orders in the same sequence
+    auto _index = detail::CellIndex(static_cast<detail::CellIndex::Order>(order),
+                                    size[0], size[1]);
+    if (_layout == layout &&
+        (layout != Layout::coefficients || _index.order == index.order))
+      return memory();
+    auto peak = memory();
+    if (layout != Layout::matrices) {
+      y = node_matrix(0);
+      dydx1 = node_matrix(1);
+      dydx2 = node_matrix(2);
+      d2ydx1dx2 = node_matrix(3);
+      peak = memory();
+      coefficients = std::vector<S>();
+      nodes = std::vector<S>();
+      mapping.reset();
+    }
+    index = _index;
+    if (_layout == Layout::coefficients)
+      compute_coefficients();
+    if (_layout == Layout::nodes)
+      nodes = interleave(y, dydx1, dydx2, d2ydx1dx2);
+    peak = std::max(peak, memory());
+    if (_layout != Layout::matrices)
+      y = dydx1 = dydx2 = d2ydx1dx2 = MatrixX();
+    layout = _layout;
+    return peak;
   }
 
   StorageData to_storage_data() const;
 };
 
-template <typename T> struct BicubicSplines<T>::StorageData {
-  using MatrixX = ::Eigen::Matrix<T, ::Eigen::Dynamic, ::Eigen::Dynamic>;
+/**
+ * @brief Tables which are split into tiles of `cells x cells` cells and
+ * sampled tile by tile on the first query of a cell. The value and the
+ * derivatives of every node are sampled with finite differences, so a tile
+ * does not depend on its neighbours and the nodes at the border of a tile are
+ * sampled by both. Definitions which approximate the derivatives or calculate
+ * them from the grid are rejected, their splines require the complete axes. The function and pointers to the axes and the trafo of the
+ * definition are kept, they have to outlive the tables. If a file is given,
+ * the built tiles are written to it when the tables are released, as a table
+ * file once every tile has been built and as a tile file of the built tiles
+ * otherwise.
+ *
+ * A tile is built by the thread which queries it first, so different tiles
+ * are sampled concurrently and the function has to be thread safe. The tiles
+ * are sampled without the statistics of the definition, every built tile is
+ * recorded afterwards as a phase *tile* under a lock.
+ */
+template <typename T, typename S> struct BicubicSplines<T, S>::RuntimeData::Lazy {
+  // the part of the definition required to sample a tile, the statistics are
+  // not shared by the concurrent builds
+  struct Source {
+    std::function<T(T, T)> f;
+    std::function<void(T const *, T const *, T *, size_t)> f_batch;
+    Axis<T> const *f_trafo;
+    std::array<Axis<T> const *, 2> axis;
+    Executor executor;
+    BuildStatistics *statistics = nullptr;
+  };
+
+  struct Tile {
+    std::array<long int, 2> nodes; // nodes of the tile along both axes
+    std::vector<S> records;        // node records, first axis fastest
+    std::vector<S> coefficients;   // cell polynomials, first axis fastest
+  };
+
+  Source source;
+  detail::TileGrid grid;
+  detail::TileCache<Tile> cache;
+  std::string file;
+  std::atomic<bool> modified;
+  BuildStatistics *statistics;
+  std::mutex statistics_mutex;
+
+  Lazy(Definition const &def, long int _cells, std::string _file)
+      : source{def.f, def.f_batch, def.f_trafo.get(),
+               {def.axis[0].get(), def.axis[1].get()}, def.executor},
+        grid({static_cast<long int>(def.axis[0]->required_nodes()),
+              static_cast<long int>(def.axis[1]->required_nodes())},
+             _cells),
+        cache(grid.count(), [this](size_t t) { return build(t); }),
+        file(std::move(_file)), modified(false), statistics(def.statistics) {
+    // the splines of both options run along the complete axes
+    if (def.approx_derivates || def.derivatives != DerivativeSource::sampled)
+      throw std::invalid_argument("Lazy tables sample the derivatives at every node, "
+                                  "approx_derivates and grid derivatives are not "
+                                  "supported.");
+  }
+
+  Lazy(Lazy const &) = delete;
+  Lazy &operator=(Lazy const &) = delete;
+
+  ~Lazy();
+
+  /**
+   * @brief Sample the nodes of a tile. The points are the same as of a complete
+   * build without approximated derivatives, so are the tables.
+   */
+  Tile build(size_t t) {
+    auto start = std::chrono::steady_clock::now();
+    auto o = grid.origin(t);
+    auto tile = Tile{grid.extent(t), {}, {}};
+    auto const &ax0 = *source.axis[0];
+    auto const &ax1 = *source.axis[1];
+    auto stencils = detail::NodeStencils<T, Axis<T>>{ax0, ax1};
+    auto m0 = static_cast<size_t>(tile.nodes[0]);
+    auto node = [&](size_t k) {
+      return std::array<size_t, 2>{static_cast<size_t>(o[0]) + k % m0,
+                                   static_cast<size_t>(o[1]) + k / m0};
+    };
+    tile.records.resize(n_fields * m0 * tile.nodes[1]);
+    auto evaluations = detail::sample_tasks<T, 2>(
+        source, m0 * tile.nodes[1], 1 + stencils.n_derivatives,
+        [&](size_t k, std::array<T *, 2> x) {
+          auto n = node(k);
+          x[0][0] = ax0.back_transform(n[0]);
+          x[1][0] = ax1.back_transform(n[1]);
+          stencils.derivatives(n[0], n[1], {x[0] + 1, x[1] + 1});
+        },
+        [&](size_t k, T const *v) {
+          auto n = node(k);
+          auto d = stencils.derivatives(n[0], n[1], v + 1);
+          auto r = tile.records.data() + n_fields * k;
+          r[0] = v[0];
+          std::copy(d.begin(), d.end(), r + 1);
+        });
+    tile.coefficients = polynomials(tile);
+    modified = true;
+    if (statistics) {
+      auto seconds =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::lock_guard<std::mutex> lock(statistics_mutex);
+      statistics->phases.push_back({"tile", seconds});
+      statistics->function_evaluations += evaluations;
+    }
+    return tile;
+  }
+
+  static std::vector<S> polynomials(Tile const &tile) {
+    auto c0 = tile.nodes[0] - 1, c1 = tile.nodes[1] - 1;
+    auto c = std::vector<S>(n_coeff * c0 * c1);
+    auto temp = Matrix4();
+    for (long int j = 0; j < c1; ++j) {
+      for (long int i = 0; i < c0; ++i) {
+        hermite(tile.records.data() + n_fields * (i + tile.nodes[0] * j),
+                n_fields * tile.nodes[0], temp);
+        cell_polynomial(temp, c.data() + n_coeff * (i + c0 * j));
+      }
+    }
+    return c;
+  }
+
+  /**
+   * @brief Take over the node records of a tile which has been built before.
+   */
+  void insert(size_t t, std::vector<S> records) {
+    auto tile = Tile{grid.extent(t), std::move(records), {}};
+    tile.coefficients = polynomials(tile);
+    cache.insert(t, std::move(tile));
+  }
+
+  /**
+   * @brief Polynomial coefficients of the cell starting at node (n0, n1), the
+   * tile of the cell is built if required.
+   */
+  S const *cell(unsigned int n0, unsigned int n1) {
+    auto const &tile = cache.get(grid.tile(n0, n1));
+    auto c0 = tile.nodes[0] - 1;
+    return tile.coefficients.data() +
+           n_coeff * (n0 % grid.cells + c0 * (n1 % grid.cells));
+  }
+
+  /**
+   * @brief Take over the tiles stored in a tile file.
+   */
+  void insert(detail::TileFile<S, n_fields> &tiles) {
+    if (tiles.grid().size != grid.size || tiles.grid().cells != grid.cells)
+      throw std::runtime_error("The stored tiles do not match the definition.");
+    for (size_t t = 0; t < grid.count(); ++t)
+      if (tiles.contains(t))
+        insert(t, tiles.read(t));
+  }
+
+  /**
+   * @brief Node records of the complete tables, missing tiles are built.
+   */
+  std::vector<S> records() {
+    for (size_t t = 0; t < cache.size(); ++t)
+      cache.get(t);
+    return built_records();
+  }
+
+  /**
+   * @brief Node records of the complete tables, which have to be built.
+   */
+  std::vector<S> built_records() const {
+    auto const &size = grid.size;
+    auto r = std::vector<S>(n_fields * size[0] * size[1]);
+    for (size_t t = 0; t < cache.size(); ++t) {
+      auto const &tile = *cache.find(t);
+      auto o = grid.origin(t);
+      for (long int j = 0; j < tile.nodes[1]; ++j)
+        std::copy_n(tile.records.data() + n_fields * tile.nodes[0] * j,
+                    n_fields * tile.nodes[0],
+                    r.data() + n_fields * (o[0] + size[0] * (o[1] + j)));
+    }
+    return r;
+  }
+
+  /**
+   * @brief Write the built tiles to the file.
+   */
+  void save() const {
+    auto built = std::vector<size_t>();
+    for (size_t t = 0; t < cache.size(); ++t)
+      if (cache.find(t))
+        built.push_back(t);
+    if (built.size() == grid.count()) {
+      auto r = built_records();
+      detail::MappedTable<S>::write(file, grid.size, n_fields, r.data(), r.size());
+      return;
+    }
+    detail::TileFile<S, n_fields>::write_by_tile(file, grid, built, [&](size_t t, S *r) {
+      auto const &records = cache.find(t)->records;
+      std::copy(records.begin(), records.end(), r);
+    });
+  }
+};
+
+template <typename T, typename S>
+constexpr long int BicubicSplines<T, S>::RuntimeData::tile_cells;
+
+/**
+ * @brief Tables which are read tile by tile from a tile file on the first
+ * query of a tile and kept resident up to a memory budget, the least recently
+ * used tiles are evicted first. The node records of the tiles are kept and the
+ * polynomial of a cell is assembled on every query, as with the nodes layout.
+ */
+template <typename T, typename S> struct BicubicSplines<T, S>::RuntimeData::Paged {
+  using File = detail::TileFile<S, n_fields>;
+
+  File file;
+  detail::LruTileCache<std::vector<S>> cache;
+
+  Paged(std::string const &path, size_t budget)
+      : file(path), cache(file.grid().count(), budget,
+                          [this](size_t t) { return file.read(t); },
+                          [](std::vector<S> const &r) { return sizeof(S) * r.capacity(); }) {
+    if (!file.complete())
+      throw std::runtime_error("The tile file misses tiles of the tables: " + path);
+  }
+
+  Paged(Paged const &) = delete;
+  Paged &operator=(Paged const &) = delete;
+
+  T const *cell(unsigned int n0, unsigned int n1, std::array<T, n_coeff> &buffer) {
+    auto const &grid = file.grid();
+    auto t = grid.tile(n0, n1);
+    auto nodes0 = static_cast<size_t>(grid.extent(t)[0]);
+    return cache.visit(t, [&](std::vector<S> const &records) {
+      auto temp = Matrix4();
+      hermite(records.data() + n_fields * (n0 % grid.cells + nodes0 * (n1 % grid.cells)),
+              n_fields * nodes0, temp);
+      cell_polynomial(temp, buffer.data());
+      return static_cast<T const *>(buffer.data());
+    });
+  }
+
+  /**
+   * @brief Node records of the complete tables.
+   */
+  std::vector<S> records() {
+    auto const &grid = file.grid();
+    auto r = std::vector<S>(n_fields * grid.size[0] * grid.size[1]);
+    for (size_t t = 0; t < grid.count(); ++t) {
+      auto tile = cache.get(t);
+      auto o = grid.origin(t);
+      auto e = grid.extent(t);
+      for (long int j = 0; j < e[1]; ++j)
+        std::copy_n(tile->data() + n_fields * e[0] * j, n_fields * e[0],
+                    r.data() + n_fields * (o[0] + grid.size[0] * (o[1] + j)));
+    }
+    return r;
+  }
+};
 
+template <typename T, typename S> struct BicubicSplines<T, S>::StorageData {
   ::std::array<long int, 2> size;
-  ::std::vector<T> y, dydx1, dydx2, d2ydx1dx2;
+  ::std::vector<S> nodes; // interleaved node records, see RuntimeData
+  long int tile = 0;      // cells per side of the stored tiles, zero if complete
+  ::std::vector<unsigned int> tiles; // stored tiles, their records follow each other
 
-  friend class boost::serialization::access;
-  template <class Archive> void serialize(Archive &ar, const unsigned int) {
-    ar &size;
-    ar &y;
-    ar &dydx1;
-    ar &dydx2;
-    ar &d2ydx1dx2;
+  template <class Archive>
+  static void values(Archive &ar, std::vector<S> &v, unsigned int precision) {
+    if (precision == sizeof(S)) {
+      ar &v;
+      return;
+    }
+    if (precision != sizeof(float) && precision != sizeof(double))
+      throw std::runtime_error("Unknown precision of the interpolation tables.");
+    using Other = std::conditional_t<std::is_same<S, float>::value, double, float>;
+    auto stored = std::vector<Other>();
+    ar &stored;
+    v.assign(stored.begin(), stored.end());
   }
 
-  template <typename V> inline auto to_matrix(V v) const {
-    return ::Eigen::Map<MatrixX>(v.data(), size[0], size[1]);
+  /**
+   * @brief Since version 1 the size of the stored floating point type is
+   * written ahead of the tables. Tables of the other precision are converted
+   * on load, version 0 tables have been stored with the evaluation precision.
+   * Since version 2 the node records are stored interleaved as they are kept
+   * in memory, older tables store the four node matrices one after another.
+   * Since version 3 tables which have been built lazily store only the built
+   * tiles.
+   */
+  friend class boost::serialization::access;
+  template <class Archive> void serialize(Archive &ar, const unsigned int version) {
+    auto precision = static_cast<unsigned int>(version > 0 ? sizeof(S) : sizeof(T));
+    ar &size;
+    if (version > 0)
+      ar &precision;
+    if (version > 2) {
+      ar &tile;
+      ar &tiles;
+    }
+    if (version > 1) {
+      values(ar, nodes, precision);
+      return;
+    }
+    auto matrices = std::array<std::vector<S>, RuntimeData::n_fields>();
+    for (auto &v : matrices)
+      values(ar, v, precision);
+    nodes.resize(RuntimeData::n_fields * matrices[0].size());
+    for (size_t k = 0; k < matrices[0].size(); ++k)
+      for (size_t f = 0; f < RuntimeData::n_fields; ++f)
+        nodes[RuntimeData::n_fields * k + f] = matrices[f][k];
   }
 
 public:
   StorageData() = default;
 
-  template <typename T1>
-  StorageData(std::array<long int, 2> _size, T1 &&_y, T1 &&_dydx1, T1 &&_dydx2,
-              T1 &&_d2ydx1dx2)
-      : size(std::move(_size)), y(std::forward<T1>(_y)), dydx1(std::forward<T1>(_dydx1)),
-        dydx2(std::forward<T1>(_dydx2)), d2ydx1dx2(std::forward<T1>(_d2ydx1dx2)){};
+  StorageData(std::array<long int, 2> _size, std::vector<S> _nodes)
+      : size(std::move(_size)), nodes(std::move(_nodes)){};
+
+  StorageData(std::array<long int, 2> _size, std::vector<S> _nodes, long int _tile,
+              std::vector<unsigned int> _tiles)
+      : size(std::move(_size)), nodes(std::move(_nodes)), tile(_tile),
+        tiles(std::move(_tiles)){};
+
+  /**
+   * @brief Write the tables in the mapped format, an existing file is
+   * replaced.
+   */
+  void write(std::string const &file) const {
+    detail::MappedTable<S>::write(file, size, RuntimeData::n_fields, nodes.data(),
+                                  nodes.size());
+  }
 
-  auto to_runtime_data() const {
-    return RuntimeData(to_matrix(y), to_matrix(dydx1), to_matrix(dydx2),
-                       to_matrix(d2ydx1dx2));
+  /**
+   * @brief Write the tables in the mapped format if the file does not exist.
+   * Returns whether the file has been written.
+   */
+  bool save(std::string const &file) const {
+    if (fs::exists(file))
+      return false;
+    write(file);
+    return true;
+  }
+
+  /**
+   * @brief Write the tables tile by tile for out-of-core queries.
+   */
+  void write_tiles(std::string const &file, detail::TileGrid const &grid) const {
+    detail::TileFile<S, RuntimeData::n_fields>::write(file, grid, nodes.data());
+  }
+
+  /**
+   * @brief Lazy tables starting with the stored tiles, which write the tiles
+   * built later back to the file.
+   */
+  auto to_lazy(Definition const &def, std::string file) {
+    auto lazy = std::make_shared<typename RuntimeData::Lazy>(def, tile, std::move(file));
+    if (lazy->grid.size != size)
+      throw std::runtime_error("The stored tiles do not match the definition.");
+    auto first = nodes.begin();
+    for (auto t : tiles) {
+      auto e = lazy->grid.extent(t);
+      auto last = first + RuntimeData::n_fields * e[0] * e[1];
+      lazy->insert(t, std::vector<S>(first, last));
+      first = last;
+    }
+    return lazy;
   }
 };
 
-template <typename T>
-typename BicubicSplines<T>::StorageData
-BicubicSplines<T>::RuntimeData::to_storage_data() const {
-  return StorageData(get_dimensions(), to_vector(y), to_vector(dydx1), to_vector(dydx2),
-                     to_vector(d2ydx1dx2));
+} // namespace cubic_splines
+
+namespace {
+using BicubicStorageDouble = cubic_splines::BicubicSplines<double>::StorageData;
+using BicubicStorageFloat = cubic_splines::BicubicSplines<float>::StorageData;
+using BicubicStorageMixed = cubic_splines::BicubicSplines<double, float>::StorageData;
+} // namespace
+
+BOOST_CLASS_VERSION(BicubicStorageDouble, 3)
+BOOST_CLASS_VERSION(BicubicStorageFloat, 3)
+BOOST_CLASS_VERSION(BicubicStorageMixed, 3)
+
+namespace cubic_splines {
+
+template <typename T, typename S>
+typename BicubicSplines<T, S>::StorageData
+BicubicSplines<T, S>::RuntimeData::to_storage_data() const {
+  if (lazy)
+    return StorageData(get_dimensions(), lazy->records());
+  if (paged)
+    return StorageData(get_dimensions(), paged->records());
+  if (layout == Layout::nodes)
+    return StorageData(get_dimensions(),
+                       std::vector<S>(records(), records() + n_fields * size[0] * size[1]));
+  if (layout == Layout::coefficients)
+    return StorageData(get_dimensions(), interleave(node_matrix(0), node_matrix(1),
+                                                    node_matrix(2), node_matrix(3)));
+  return StorageData(get_dimensions(), interleave(y, dydx1, dydx2, d2ydx1dx2));
+}
+
+namespace detail {
+/**
+ * @brief Append the type and all parameters of the axis, or "none" if there is
+ * no axis, to a build key. The description is hashed with 64 bit FNV-1a and
+ * the hash is appended as two halves, which are exact as doubles.
+ */
+template <typename T> void describe(std::vector<double> &key, Axis<T> const *axis) {
+  auto os = std::ostringstream();
+  os.precision(std::numeric_limits<T>::max_digits10);
+  if (axis)
+    os << typeid(*axis).name() << ' ' << *axis;
+  else
+    os << "none";
+  auto h = std::uint64_t{14695981039346656037u};
+  for (unsigned char c : os.str())
+    h = (h ^ c) * std::uint64_t{1099511628211u};
+  key.push_back(double(h >> 32));
+  key.push_back(double(h & 0xffffffffu));
+}
+
+/**
+ * @brief Key of the records of the sampled values of a build, which are only
+ * taken over by a build with the same axes, function value trafo and
+ * derivatives.
+ */
+template <typename Definition> std::vector<double> build_key(Definition const &def) {
+  auto const &ax = def.axis;
+  auto key = std::vector<double>{double(ax[0]->required_nodes()),
+                                 double(ax[1]->required_nodes()),
+                                 double(def.approx_derivates),
+                                 double(static_cast<int>(def.derivatives))};
+  describe(key, ax[0].get());
+  describe(key, ax[1].get());
+  describe(key, def.f_trafo.get());
+  return key;
 }
 
-template <typename T>
-BicubicSplines<T>::BicubicSplines(BicubicSplines::RuntimeData _data)
-    : data(::std::make_unique<BicubicSplines::RuntimeData>(_data)) {}
+std::string shard_file(std::string const &path, std::string const &filename,
+                       size_t shard) {
+  return (fs::path(path) / (filename + ".shard" + std::to_string(shard))).string();
+}
+} // namespace detail
 
-template <typename T>
-BicubicSplines<T>::BicubicSplines(Definition const &def, std::string path,
-                                  std::string filename) {
+template <typename T, typename S> BicubicSplines<T, S>::RuntimeData::Lazy::~Lazy() {
+  if (!modified || file.empty())
+    return;
+  // a destructor must not throw, the tiles are built again by the next run
   try {
-    auto storage_data = load<BicubicSplines>(path, filename);
-    *this = BicubicSplines(storage_data.to_runtime_data());
+    save();
+  } catch (std::exception const &) {
+  }
+}
+
+template <typename T, typename S>
+BicubicSplines<T, S>::BicubicSplines(BicubicSplines::RuntimeData _data)
+    : data(::std::make_shared<BicubicSplines::RuntimeData>(std::move(_data))) {}
+
+template <typename T, typename S>
+BicubicSplines<T, S>::BicubicSplines(Definition const &def, std::string path,
+                                     std::string filename) {
+  // the tiles of a lazy build and the tiles of out-of-core tables are both
+  // stored next to the table file, a definition has to choose one of them
+  if (def.lazy && def.memory_budget > 0)
+    throw std::invalid_argument("Lazy tables can not be kept out of core.");
+  if (def.memory_budget > 0 && !filename.empty())
+    open_paged(def, path, filename);
+  else
+    open_tables(def, path, filename);
+}
+
+template <typename T, typename S>
+void BicubicSplines<T, S>::open_tables(Definition const &def, std::string const &path,
+                                       std::string const &filename) {
+  auto stats = def.statistics;
+  auto file = (fs::path(path) / filename).string();
+  try {
+    detail::PhaseTimer phase(stats, "load");
+    if (!filename.empty() && detail::MappedTable<S>::is_table(file))
+      open_mapped(def, file);
+    else
+      open_stored(def, path, filename);
+    if (stats)
+      stats->serialized_bytes += fs::file_size(file);
+    phase.stop();
   } catch (std::system_error const &ex) {
     if (ex.code().value() != ENOENT)
       throw(ex);
-    *this = BicubicSplines(def);
-    save(data->to_storage_data(), path, filename);
+    build_tables(def, path, filename);
   }
 }
 
-template <typename T>
-std::tuple<T, T> BicubicSplines<T>::back_transform(Definition const &def,
-                                                   unsigned long n1,
-                                                   unsigned long n2) const {
-  auto x1 = def.axis[0]->back_transform(n1);
-  auto x2 = def.axis[1]->back_transform(n2);
-  return std::make_tuple(x1, x2);
+template <typename T, typename S>
+void BicubicSplines<T, S>::open_mapped(Definition const &def, std::string const &file) {
+  data = std::make_shared<RuntimeData>(
+      std::make_shared<detail::MappedTable<S> const>(file, RuntimeData::n_fields));
+  detail::record_memory(def.statistics, data->set_layout(def.layout, def.cell_order));
 }
 
-template <typename T>
-template <typename T1>
-std::array<T, 2>
-BicubicSplines<T>::_prime(T1 func, std::array<std::unique_ptr<Axis<T>>, 2> const &axis,
-                          unsigned int n1, unsigned int n2) {
-  using boost::math::differentiation::finite_difference_derivative;
-  auto f_x1 = [&func, ax = axis[0].get(), x2 = axis[1]->back_transform(n2)](T t1) {
-    return func(ax->back_transform(t1), x2);
-  };
-  auto f_x2 = [&func, ax = axis[1].get(), x1 = axis[0]->back_transform(n1)](T t2) {
-    return func(x1, ax->back_transform(t2));
-  };
-  auto dydx = std::array<T, 2>();
-  dydx[0] = finite_difference_derivative(f_x1, static_cast<T>(n1));
-  dydx[1] = finite_difference_derivative(f_x2, static_cast<T>(n2));
-  return dydx;
+template <typename T, typename S>
+void BicubicSplines<T, S>::open_stored(Definition const &def, std::string const &path,
+                                       std::string const &filename) {
+  auto file = (fs::path(path) / filename).string();
+  auto lazy = std::shared_ptr<typename RuntimeData::Lazy>();
+  auto records = std::vector<S>();
+  if (!filename.empty() && RuntimeData::Paged::File::is_tile_file(file)) {
+    // the tiles of a lazy build
+    typename RuntimeData::Paged::File tiles(file);
+    lazy = std::make_shared<typename RuntimeData::Lazy>(def, tiles.grid().cells,
+                                                        def.lazy ? file : "");
+    lazy->insert(tiles);
+  } else {
+    // tables in the boost archive format of earlier versions
+    auto storage_data = load<BicubicSplines>(path, filename);
+    if (storage_data.tile == 0)
+      records = std::move(storage_data.nodes);
+    else
+      lazy = storage_data.to_lazy(def, def.lazy ? file : "");
+  }
+  if (lazy && def.lazy) {
+    data = std::make_shared<RuntimeData>(std::move(lazy));
+    return;
+  }
+  // the missing tiles of a lazy build are completed and the file replaced
+  auto completed = lazy != nullptr;
+  if (completed)
+    records = lazy->records();
+  lazy.reset();
+  auto size = std::array<long int, 2>{
+      static_cast<long int>(def.axis[0]->required_nodes()),
+      static_cast<long int>(def.axis[1]->required_nodes())};
+  if (records.size() != RuntimeData::n_fields * size[0] * size[1])
+    throw std::runtime_error("The table file does not match the definition.");
+  data = std::make_shared<RuntimeData>(size, std::move(records));
+  detail::record_memory(def.statistics, data->set_layout(def.layout, def.cell_order));
+  if (completed)
+    data->to_storage_data().write(file);
 }
 
-/* template <typename T> */
-/* template <typename T1> */
-/* std::vector<std::tuple<unsigned int, T>> */
-/* BicubicSplines<T>::_prime(std::vector<T> const &yi, T1 func, unsigned int n_max) { */
-/*   auto spline = boost::math::interpolators::cardinal_cubic_b_spline<T>( */
-/*       yi.data(), yi.size(), 0, 1, func(0u), func(n_max)); */
-/*   auto diff = std::vector<std::tuple<unsigned int, T>>(); */
-/*   for (auto i = 0u; i < n_max; ++i) */
-/*     diff.emplace_back(i, spline.prime(i)); */
-/*   return diff; */
-/* } */
-
-template <typename T>
-template <typename T1>
-T BicubicSplines<T>::_double_prime(Definition const &def, T1 func, unsigned int n1,
-                                   unsigned int n2) {
-  using boost::math::differentiation::finite_difference_derivative;
-  auto f_x1 = [&func, ax = def.axis[0].get()](T t1, T t2) {
-    return func(ax->back_transform(t1), t2);
-  };
-  auto dydx1 = [&f_x1, n1](T t2) {
-    return finite_difference_derivative([&f_x1, t2](T t1) { return f_x1(t1, t2); },
-                                        static_cast<T>(n1));
-  };
-  auto dydx1_x2 = [&dydx1, ax = def.axis[1].get()](T t2) {
-    return dydx1(ax->back_transform(t2));
-  };
-  return finite_difference_derivative(dydx1_x2, static_cast<T>(n2));
+template <typename T, typename S>
+void BicubicSplines<T, S>::build_tables(Definition const &def, std::string const &path,
+                                        std::string const &filename) {
+  auto stats = def.statistics;
+  auto file = (fs::path(path) / filename).string();
+  if (def.lazy) {
+    // the tiles are written to the file once they have been built
+    data = std::make_shared<RuntimeData>(std::make_shared<typename RuntimeData::Lazy>(
+        def, RuntimeData::tile_cells, filename.empty() ? "" : file));
+    return;
+  }
+  auto checkpoint = std::unique_ptr<detail::Checkpoint<T>>();
+  if (def.checkpoint && !filename.empty())
+    checkpoint = std::make_unique<detail::Checkpoint<T>>(
+        (fs::path(path) / (filename + ".checkpoint")).string(), detail::build_key(def));
+  *this = BicubicSplines(def, checkpoint.get());
+  detail::PhaseTimer phase(stats, "save");
+  if (!filename.empty() && data->to_storage_data().save(file) && stats)
+    stats->serialized_bytes += fs::file_size(file);
+  phase.stop();
+  if (checkpoint)
+    checkpoint->remove();
 }
 
-template <typename T>
-BicubicSplines<T>::BicubicSplines(Definition const &def)
-    : data(std::make_shared<RuntimeData>(def.axis[0]->required_nodes(),
-                                         def.axis[1]->required_nodes())) {
-  using boost::math::differentiation::finite_difference_derivative;
-  auto func = [&def](T x1, T x2) {
-    if (def.f_trafo)
-      return def.f_trafo->transform(def.f(x1, x2));
-    return def.f(x1, x2);
-  };
-
-  for (auto n1 = 0u; n1 < data->y.rows(); ++n1) {
-    for (auto n2 = 0u; n2 < data->y.cols(); ++n2) {
-      auto x = back_transform(def, n1, n2);
-      data->y(n1, n2) = func(std::get<0>(x), std::get<1>(x));
+template <typename T, typename S>
+void BicubicSplines<T, S>::open_paged(Definition const &def, std::string const &path,
+                                      std::string const &filename) {
+  auto file = (fs::path(path) / filename).string();
+  auto tile_file = file + ".tiles";
+  auto grid = detail::TileGrid({static_cast<long int>(def.axis[0]->required_nodes()),
+                                static_cast<long int>(def.axis[1]->required_nodes())},
+                               RuntimeData::tile_cells);
+  if (!fs::is_regular_file(tile_file)) {
+    if (!detail::MappedTable<S>::is_table(file)) {
+      // the tables are loaded or built in memory, a build is saved as table
+      // file; tables in the boost archive format are written tile by tile
+      open_tables(def, path, filename);
+      if (!detail::MappedTable<S>::is_table(file))
+        data->to_storage_data().write_tiles(tile_file, grid);
+      // the tables are released before the tiles are copied from the table file
+      data.reset();
+    }
+    if (!fs::is_regular_file(tile_file)) {
+      // the table file is only read as far as the tiles are written
+      detail::MappedTable<S> const table(file, RuntimeData::n_fields);
+      if (table.size() != grid.size)
+        throw std::runtime_error("The table file does not match the definition.");
+      RuntimeData::Paged::File::write_by_tile(tile_file, grid, [&](size_t t, S *r) {
+        auto o = grid.origin(t);
+        auto e = grid.extent(t);
+        auto n = static_cast<size_t>(RuntimeData::n_fields * e[0]);
+        for (long int j = 0; j < e[1]; ++j)
+          table.copy(RuntimeData::n_fields * (o[0] + grid.size[0] * (o[1] + j)), n,
+                     r + n * j);
+      });
     }
   }
+  detail::PhaseTimer phase(def.statistics, "load");
+  auto paged = std::make_shared<typename RuntimeData::Paged>(tile_file, def.memory_budget);
+  if (paged->file.grid().size != grid.size)
+    throw std::runtime_error("The tile file does not match the definition.");
+  data = std::make_shared<RuntimeData>(std::move(paged));
+  phase.stop();
+}
 
-  auto n_rows = data->y.rows();
-  auto n_cols = data->y.cols();
-  if (def.approx_derivates) {
-    for (auto n1 = 0u; n1 < n_cols; ++n1) {
-      auto yi = RuntimeData::to_vector(data->y.col(n1));
-      auto diff = [this, &def, &func, n1](unsigned int n) {
-        return _prime(func, def.axis, n, n1)[0];
-      };
-      auto spline = boost::math::interpolators::cardinal_cubic_b_spline<T>(
-          yi.data(), yi.size(), 0, 1, diff(0u), diff(n_rows - 1));
-      for (auto row = 0; row < n_rows; ++row)
-        data->dydx1(n1, row) = spline.prime(row);
-    }
-    data->dydx1.transposeInPlace();
-
-    ::Eigen::Matrix<T, ::Eigen::Dynamic, ::Eigen::Dynamic> y_rowise = data->y;
-    y_rowise.transposeInPlace();
-    for (auto n2 = 0u; n2 < n_rows; ++n2) {
-      auto yi = RuntimeData::to_vector(y_rowise.col(n2));
-      auto diff = [this, &def, &func, n2](unsigned int n) {
-        return _prime(func, def.axis, n2, n)[1];
-      };
-      auto spline = boost::math::interpolators::cardinal_cubic_b_spline<T>(
-          yi.data(), yi.size(), 0, 1, diff(0u), diff(n_cols - 1));
-      for (auto col = 0; col < n_cols; ++col)
-        data->dydx2(col, n2) = spline.prime(col);
-    }
-    data->dydx2.transposeInPlace();
-  } else {
-    for (auto n1 = 0u; n1 < n_rows; ++n1) {
-      for (auto n2 = 0u; n2 < n_cols; ++n2) {
-        auto dydx = _prime(func, def.axis, n1, n2);
-        data->dydx1(n1, n2) = dydx[0];
-        data->dydx2(n1, n2) = dydx[1];
-      }
-    }
+template <typename T, typename S>
+void BicubicSplines<T, S>::build_shard(Definition const &def, std::string path,
+                                       std::string filename, size_t shard,
+                                       size_t shards) {
+  if (shard >= shards)
+    throw std::invalid_argument("The shard index exceeds the number of shards.");
+  if (def.lazy)
+    throw std::invalid_argument("Lazy tables can not be built in shards.");
+  auto checkpoint = detail::Checkpoint<T>(detail::shard_file(path, filename, shard),
+                                          detail::build_key(def), shard, shards);
+  // a single shard is a complete build whose values are kept for the merge
+  auto build = BicubicSplines(def, &checkpoint);
+  checkpoint.finish();
+}
+
+template <typename T, typename S>
+BicubicSplines<T, S> BicubicSplines<T, S>::merge_shards(Definition const &def,
+                                                        std::string path,
+                                                        std::string filename,
+                                                        size_t shards) {
+  if (shards == 0)
+    throw std::invalid_argument("A sharded build requires at least one shard.");
+  if (def.lazy)
+    throw std::invalid_argument("Lazy tables can not be built in shards.");
+  auto files = std::vector<std::string>();
+  for (size_t i = 0; i < shards; ++i)
+    files.push_back(detail::shard_file(path, filename, i));
+  auto checkpoint = detail::Checkpoint<T>(files, detail::build_key(def));
+  auto merged = BicubicSplines(def, &checkpoint);
+  detail::PhaseTimer phase(def.statistics, "save");
+  auto file = (fs::path(path) / filename).string();
+  // the shards are the only copy of the values until the tables are saved
+  if (!merged.data->to_storage_data().save(file))
+    throw std::runtime_error("The table file " + file +
+                             " exists already, the shards have been kept.");
+  if (def.statistics)
+    def.statistics->serialized_bytes += fs::file_size(file);
+  phase.stop();
+  for (auto const &shard : files)
+    if (std::remove(shard.c_str()) != 0)
+      throw std::runtime_error("Failed to delete the shard file " + shard);
+  return merged;
+}
+
+template <typename T, typename S>
+PageStatistics BicubicSplines<T, S>::page_statistics() const {
+  return data->paged ? data->paged->cache.statistics() : PageStatistics();
+}
+
+template <typename T, typename S>
+std::tuple<T, T> BicubicSplines<T, S>::back_transform(Definition const &def,
+                                                      unsigned long n1,
+                                                      unsigned long n2) const {
+  auto x1 = def.axis[0]->back_transform(n1);
+  auto x2 = def.axis[1]->back_transform(n2);
+  return std::make_tuple(x1, x2);
+}
+
+template <typename T, typename S>
+BicubicSplines<T, S>::BicubicSplines(Definition const &def)
+    : BicubicSplines(def, nullptr) {}
+
+template <typename T, typename S>
+BicubicSplines<T, S>::BicubicSplines(Definition const &def,
+                                     detail::Checkpoint<T> *checkpoint) {
+  if (def.lazy) {
+    data = std::make_shared<RuntimeData>(std::make_shared<typename RuntimeData::Lazy>(
+        def, RuntimeData::tile_cells, ""));
+    return;
   }
-  if (def.approx_derivates) {
-    ::Eigen::Matrix<T, ::Eigen::Dynamic, ::Eigen::Dynamic> dydx1_rowise = data->dydx1;
-    dydx1_rowise.transposeInPlace();
-    for (auto n2 = 0u; n2 < n_rows; ++n2) {
-      auto yi = RuntimeData::to_vector(dydx1_rowise.col(n2));
-      auto diff = [this, &def, &func, n2](unsigned int n) {
-        return _double_prime(def, func, n2, n);
-      };
-      auto spline = boost::math::interpolators::cardinal_cubic_b_spline<T>(
-          yi.data(), yi.size(), 0, 1, diff(0u), diff(n_cols - 1));
-      for (auto col = 0; col < n_cols; ++col)
-        data->d2ydx1dx2(col, n2) = spline.prime(col);
+  using boost::math::interpolators::cardinal_cubic_b_spline;
+  using detail::FiniteDifference;
+  using MatrixX = ::Eigen::Matrix<T, ::Eigen::Dynamic, ::Eigen::Dynamic>;
+  constexpr auto n_stencil = FiniteDifference<T>::n_points;
+  auto const &ax0 = *def.axis[0];
+  auto const &ax1 = *def.axis[1];
+
+  // the tables are calculated with the evaluation precision and rounded to
+  // the storage precision afterwards
+  auto n_rows = static_cast<long int>(ax0.required_nodes());
+  auto n_cols = static_cast<long int>(ax1.required_nodes());
+  auto y = MatrixX(n_rows, n_cols);
+  auto dydx1 = MatrixX(n_rows, n_cols);
+  auto dydx2 = MatrixX(n_rows, n_cols);
+  auto d2ydx1dx2 = MatrixX(n_rows, n_cols);
+
+  auto stencils = detail::NodeStencils<T, Axis<T>>{ax0, ax1};
+
+  // Every phase consists of independent tasks, which write separate entries
+  // of the tables and can be run by the executor in any order. The points of
+  // a phase are sampled together.
+  detail::PhaseTimer nodes_phase(def.statistics, "nodes");
+  evaluations = detail::sample_tasks<T, 2>(
+      def, n_rows * n_cols, 1,
+      [&](size_t k, std::array<T *, 2> x) {
+        x[0][0] = ax0.back_transform(k % n_rows);
+        x[1][0] = ax1.back_transform(k / n_rows);
+      },
+      [&](size_t k, T const *v) { y(k % n_rows, k / n_rows) = v[0]; },
+      checkpoint);
+  nodes_phase.stop();
+
+  auto grid = def.derivatives == DerivativeSource::grid;
+  if (grid || def.approx_derivates) {
+    // splines along the first axis for every column and along the second axis
+    // for every row, the derivatives at the boundaries are calculated directly
+    // or from the node values
+    auto boundary0 = MatrixX(2, n_cols);
+    auto boundary1 = MatrixX(n_rows, 2);
+    auto boundary_mixed = MatrixX(n_rows, 2);
+    if (grid) {
+      for (long int n2 = 0; n2 < n_cols; ++n2)
+        for (int upper = 0; upper < 2; ++upper)
+          boundary0(upper, n2) =
+              detail::grid_derivative(y.col(n2).data(), n_rows, 1, upper);
+      for (long int n1 = 0; n1 < n_rows; ++n1)
+        for (int upper = 0; upper < 2; ++upper)
+          boundary1(n1, upper) =
+              detail::grid_derivative(y.data() + n1, n_cols, n_rows, upper);
+    } else {
+      detail::PhaseTimer phase(def.statistics, "derivatives");
+      evaluations += detail::sample_tasks<T, 2>(
+          def, 2 * n_cols, n_stencil,
+          [&](size_t k, std::array<T *, 2> x) {
+            stencils.prime0(k % 2 ? n_rows - 1 : 0, k / 2, x);
+          },
+          [&](size_t k, T const *v) {
+            auto fd = FiniteDifference<T>(k % 2 ? n_rows - 1 : 0);
+            boundary0(k % 2, k / 2) = fd.derivative(v);
+          },
+          checkpoint);
+      phase.stop();
+      // the boundaries along the second axis are a phase of their own
+      detail::PhaseTimer phase1(def.statistics, "derivatives");
+      evaluations += detail::sample_tasks<T, 2>(
+          def, 2 * n_rows, n_stencil * (n_stencil + 1),
+          [&](size_t k, std::array<T *, 2> x) {
+            auto t1 = k % 2 ? n_cols - 1 : 0;
+            stencils.prime1(k / 2, t1, x);
+            stencils.mixed(k / 2, t1, {x[0] + n_stencil, x[1] + n_stencil});
+          },
+          [&](size_t k, T const *v) {
+            auto t1 = k % 2 ? n_cols - 1 : 0;
+            boundary1(k / 2, k % 2) = FiniteDifference<T>(t1).derivative(v);
+            boundary_mixed(k / 2, k % 2) =
+                stencils.mixed_derivative(k / 2, t1, v + n_stencil);
+          },
+          checkpoint);
+      phase1.stop();
     }
-    data->d2ydx1dx2.transposeInPlace();
+    // a shard samples its share of the function values only
+    if (checkpoint && checkpoint->sharded())
+      return;
+
+    detail::PhaseTimer phase(def.statistics, "splines");
+
+    execute(def.executor, n_cols, [&](size_t n2) {
+      auto yi = RuntimeData::to_vector(y.col(n2));
+      auto spline = cardinal_cubic_b_spline<T>(yi.data(), yi.size(), 0, 1,
+                                               boundary0(0, n2), boundary0(1, n2));
+      for (long int n1 = 0; n1 < n_rows; ++n1)
+        dydx1(n1, n2) = spline.prime(n1);
+    });
+    detail::report_progress(def.statistics, 1. / 3.);
+    MatrixX y_rowwise = y.transpose();
+    execute(def.executor, n_rows, [&](size_t n1) {
+      auto yi = RuntimeData::to_vector(y_rowwise.col(n1));
+      auto spline = cardinal_cubic_b_spline<T>(yi.data(), yi.size(), 0, 1,
+                                               boundary1(n1, 0), boundary1(n1, 1));
+      for (long int n2 = 0; n2 < n_cols; ++n2)
+        dydx2(n1, n2) = spline.prime(n2);
+    });
+    detail::report_progress(def.statistics, 2. / 3.);
+    if (grid)
+      for (long int n1 = 0; n1 < n_rows; ++n1)
+        for (int upper = 0; upper < 2; ++upper)
+          boundary_mixed(n1, upper) =
+              detail::grid_derivative(dydx1.data() + n1, n_cols, n_rows, upper);
+    MatrixX dydx1_rowwise = dydx1.transpose();
+    execute(def.executor, n_rows, [&](size_t n1) {
+      auto yi = RuntimeData::to_vector(dydx1_rowwise.col(n1));
+      auto spline = cardinal_cubic_b_spline<T>(
+          yi.data(), yi.size(), 0, 1, boundary_mixed(n1, 0), boundary_mixed(n1, 1));
+      for (long int n2 = 0; n2 < n_cols; ++n2)
+        d2ydx1dx2(n1, n2) = spline.prime(n2);
+    });
+    phase.stop();
   } else {
-    for (auto n1 = 0u; n1 < n_rows; ++n1) {
-      for (auto n2 = 0u; n2 < n_cols; ++n2)
-        data->d2ydx1dx2(n1, n2) = _double_prime(def, func, n1, n2);
-    }
+    // both derivatives and the mixed one at every node
+    detail::PhaseTimer phase(def.statistics, "derivatives");
+    evaluations += detail::sample_tasks<T, 2>(
+        def, n_rows * n_cols, stencils.n_derivatives,
+        [&](size_t k, std::array<T *, 2> x) {
+          stencils.derivatives(k % n_rows, k / n_rows, x);
+        },
+        [&](size_t k, T const *v) {
+          auto t0 = k % n_rows, t1 = k / n_rows;
+          auto d = stencils.derivatives(t0, t1, v);
+          dydx1(t0, t1) = d[0];
+          dydx2(t0, t1) = d[1];
+          d2ydx1dx2(t0, t1) = d[2];
+        },
+        checkpoint);
+    phase.stop();
+    if (checkpoint && checkpoint->sharded())
+      return;
   }
+  detail::PhaseTimer layout_phase(def.statistics, "layout");
+  data = std::make_shared<RuntimeData>(y, dydx1, dydx2, d2ydx1dx2);
+  detail::record_memory(def.statistics, data->set_layout(def.layout, def.cell_order));
+  layout_phase.stop();
 }
 
-template <typename T> T BicubicSplines<T>::evaluate(T x0, T x1) const {
-  auto n0 = detail::calculate_node(x0, data->y.cols());
-  auto n1 = detail::calculate_node(x1, data->y.rows());
-  auto temp = ::Eigen::Matrix<T, 4, 4>(4, 4);
-  temp.template block<2, 2>(0, 0) = data->y.block(n0, n1, 2, 2);
-  temp.template block<2, 2>(2, 0) = data->dydx1.block(n0, n1, 2, 2);
-  temp.template block<2, 2>(0, 2) = data->dydx2.block(n0, n1, 2, 2);
-  temp.template block<2, 2>(2, 2) = data->d2ydx1dx2.block(n0, n1, 2, 2);
-  auto v1 = detail::exponent_vector(x0 - n0);
-  auto v2 = detail::exponent_vector(x1 - n1);
-  return v1.dot((data->m.transpose() * (temp * data->m)) * v2);
+template <typename T, typename S> void BicubicSplines<T, S>::Cursor::seek(T x0, T x1) {
+  auto x = std::array<T, 2>{x0, x1};
+  for (size_t i = 0; i < 2; ++i) {
+    auto last = static_cast<T>(data->size[i] - 2);
+    auto n = node[i];
+    if (low[i] <= high[i] && x[i] >= high[i] && x[i] < high[i] + 1)
+      n += 1;
+    else if (low[i] <= high[i] && x[i] < low[i] && x[i] >= low[i] - 1)
+      n -= 1;
+    else if (!(x[i] >= low[i] && x[i] < high[i]))
+      n = std::max(T(0), std::min(std::floor(x[i]), last));
+    node[i] = n;
+    low[i] = n > 0 ? n : -std::numeric_limits<T>::infinity();
+    high[i] = n < last ? n + 1 : std::numeric_limits<T>::infinity();
+  }
+  auto p = data->cell(static_cast<unsigned int>(node[0]),
+                      static_cast<unsigned int>(node[1]), c);
+  if (p != c.data())
+    std::copy(p, p + RuntimeData::n_coeff, c.begin());
 }
 
-template <typename T> std::array<T, 2> BicubicSplines<T>::prime(T x0, T x1) const {
-  using boost::math::differentiation::finite_difference_derivative;
-  auto grad = std::array<T, 2>();
-  grad[0] =
-      finite_difference_derivative([this, x1](T x_0) { return evaluate(x_0, x1); }, x0);
-  grad[1] =
-      finite_difference_derivative([this, x0](T x_1) { return evaluate(x0, x_1); }, x1);
-  return grad;
+template <typename T, typename S> T BicubicSplines<T, S>::evaluate(T x0, T x1) const {
+  auto n0 = detail::calculate_node(x0, data->size[0]);
+  auto n1 = detail::calculate_node(x1, data->size[1]);
+  auto buffer = std::array<T, RuntimeData::n_coeff>();
+  return detail::horner(data->cell(n0, n1, buffer), x0 - n0, x1 - n1);
 }
 
-template <typename T> T BicubicSplines<T>::double_prime(T x0, T x1) const {
-  using boost::math::differentiation::finite_difference_derivative;
-  return finite_difference_derivative(
-      [this, x1](T x_1) {
-        return finite_difference_derivative(
-            [this, x_1](T x_2) { return evaluate(x_1, x_2); }, x1);
-      },
-      x0);
+template <typename T, typename S>
+void BicubicSplines<T, S>::evaluate(T const *x, T *out, size_t n) const {
+  auto const &d = *data;
+  if (d.lazy || d.paged || d.layout != Layout::coefficients) {
+    for (size_t k = 0; k < n; ++k)
+      out[k] = evaluate(x[2 * k], x[2 * k + 1]);
+    return;
+  }
+  // the vector kernels address the coefficients with 32 bit offsets
+  auto level = detail::simd_level();
+  if (d.coefficients.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+    level = detail::SimdLevel::scalar;
+  detail::bicubic_kernel(level, d.coefficients.data(), d.index, x, out, n);
+}
+
+template <typename T, typename S>
+std::array<T, 2> BicubicSplines<T, S>::prime(T x0, T x1) const {
+  auto n0 = detail::calculate_node(x0, data->size[0]);
+  auto n1 = detail::calculate_node(x1, data->size[1]);
+  auto buffer = std::array<T, RuntimeData::n_coeff>();
+  auto c = data->cell(n0, n1, buffer);
+  auto u = x0 - n0;
+  auto v = x1 - n1;
+  return {detail::horner_derivative(c, u, v, 1, 0),
+          detail::horner_derivative(c, u, v, 0, 1)};
+}
+
+template <typename T, typename S>
+void BicubicSplines<T, S>::prime(T const *x, T *out, size_t n) const {
+  for (size_t k = 0; k < n; ++k) {
+    auto grad = prime(x[2 * k], x[2 * k + 1]);
+    out[2 * k] = grad[0];
+    out[2 * k + 1] = grad[1];
+  }
+}
+
+template <typename T, typename S> T BicubicSplines<T, S>::double_prime(T x0, T x1) const {
+  auto n0 = detail::calculate_node(x0, data->size[0]);
+  auto n1 = detail::calculate_node(x1, data->size[1]);
+  auto buffer = std::array<T, RuntimeData::n_coeff>();
+  return detail::horner_derivative(data->cell(n0, n1, buffer), x0 - n0, x1 - n1, 1, 1);
+}
+
+template <typename T, typename S>
+std::array<T, 3> BicubicSplines<T, S>::hessian(T x0, T x1) const {
+  auto n0 = detail::calculate_node(x0, data->size[0]);
+  auto n1 = detail::calculate_node(x1, data->size[1]);
+  auto buffer = std::array<T, RuntimeData::n_coeff>();
+  auto c = data->cell(n0, n1, buffer);
+  auto u = x0 - n0;
+  auto v = x1 - n1;
+  return {detail::horner_derivative(c, u, v, 2, 0),
+          detail::horner_derivative(c, u, v, 0, 2),
+          detail::horner_derivative(c, u, v, 1, 1)};
+}
+
+template <typename T, typename S>
+Derivatives<T, 2> BicubicSplines<T, S>::evaluate_with_derivatives(T x0, T x1,
+                                                                  bool second) const {
+  auto n0 = detail::calculate_node(x0, data->size[0]);
+  auto n1 = detail::calculate_node(x1, data->size[1]);
+  auto buffer = std::array<T, RuntimeData::n_coeff>();
+  auto c = data->cell(n0, n1, buffer);
+  auto u = x0 - n0;
+  auto v = x1 - n1;
+  auto r = Derivatives<T, 2>();
+  r.value = detail::horner(c, u, v);
+  r.gradient = {detail::horner_derivative(c, u, v, 1, 0),
+                detail::horner_derivative(c, u, v, 0, 1)};
+  r.hessian = {0, 0, 0};
+  if (second)
+    r.hessian = {detail::horner_derivative(c, u, v, 2, 0),
+                 detail::horner_derivative(c, u, v, 0, 2),
+                 detail::horner_derivative(c, u, v, 1, 1)};
+  return r;
 }
 } // namespace cubic_splines
 
 template class cubic_splines::BicubicSplines<double>;
 template class cubic_splines::BicubicSplines<float>;
+template class cubic_splines::BicubicSplines<double, float>;
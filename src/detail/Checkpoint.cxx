@@ -0,0 +1,154 @@
+#include "detail/Checkpoint.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+namespace cubic_splines {
+namespace detail {
+
+namespace {
+constexpr std::uint64_t magic = 0x31504b4353425543; // "CUBSCKP1"
+
+template <typename V> bool read(std::ifstream &ifs, V &v) {
+  return bool(ifs.read(reinterpret_cast<char *>(&v), sizeof(V)));
+}
+
+template <typename V> void write(std::ofstream &ofs, V const &v) {
+  ofs.write(reinterpret_cast<char const *>(&v), sizeof(V));
+}
+
+// phase index of the record which marks the records as complete
+constexpr std::uint64_t finished = ~std::uint64_t{0};
+
+std::vector<double> shard_key(std::vector<double> key, size_t shard, size_t shards) {
+  if (shards > 1)
+    key.insert(key.end(), {double(shard), double(shards)});
+  return key;
+}
+
+/**
+ * @brief Append the values of the records with a matching key to the phases.
+ * Returns if the records have been finished. The length of the file up to the
+ * end of the last complete record is written to *length*, it is zero if the
+ * file is missing or has a different key.
+ */
+template <typename T>
+bool read_records(std::string const &file, std::vector<double> const &key,
+                  std::vector<std::vector<T>> &restored, std::uint64_t *length = nullptr) {
+  auto ifs = std::ifstream(file, std::ios::binary);
+  auto header = std::uint64_t{0}, precision = std::uint64_t{0}, n_key = std::uint64_t{0};
+  auto valid = read(ifs, header) && read(ifs, precision) && read(ifs, n_key) &&
+               header == magic && precision == sizeof(T) && n_key == key.size();
+  for (size_t k = 0; valid && k < key.size(); ++k) {
+    auto v = 0.;
+    valid = read(ifs, v) && v == key[k];
+  }
+  auto end = valid ? std::uint64_t(ifs.tellg()) : std::uint64_t{0};
+  if (length)
+    *length = end;
+  // records of the phase index, the number of values and the values
+  auto p = std::uint64_t{0}, n = std::uint64_t{0};
+  while (valid && read(ifs, p) && read(ifs, n)) {
+    if (p == finished)
+      return true;
+    if (p > restored.size())
+      break;
+    auto values = std::vector<T>(n);
+    if (!ifs.read(reinterpret_cast<char *>(values.data()), n * sizeof(T)))
+      break;
+    if (p == restored.size())
+      restored.emplace_back();
+    restored[p].insert(restored[p].end(), values.begin(), values.end());
+    if (length)
+      *length = std::uint64_t(ifs.tellg());
+  }
+  return false;
+}
+} // namespace
+
+template <typename T>
+Checkpoint<T>::Checkpoint(std::string _file, std::vector<double> const &_key,
+                          size_t _shard, size_t _shards)
+    : file(std::move(_file)), shard(_shard), shards(_shards) {
+  auto key = shard_key(_key, shard, shards);
+  auto length = std::uint64_t{0};
+  read_records(file, key, restored, &length);
+  if (length > 0) {
+    // only an incomplete record or the finish mark at the end is cut off, the
+    // complete records are kept in place and new ones are appended
+    auto ec = boost::system::error_code();
+    boost::filesystem::resize_file(file, length, ec);
+    if (ec)
+      throw std::runtime_error("Checkpoint " + file + " couldn't be written.");
+    return;
+  }
+
+  // a new file is written under a temporary name first, so an interrupted
+  // write never replaces an existing checkpoint
+  auto temp = file + ".tmp";
+  auto ofs = std::ofstream(temp, std::ios::binary | std::ios::trunc);
+  write(ofs, magic);
+  write(ofs, std::uint64_t{sizeof(T)});
+  write(ofs, std::uint64_t{key.size()});
+  for (auto v : key)
+    write(ofs, v);
+  ofs.close();
+  if (!ofs || std::rename(temp.c_str(), file.c_str()) != 0)
+    throw std::runtime_error("Checkpoint " + file + " couldn't be written.");
+}
+
+template <typename T>
+Checkpoint<T>::Checkpoint(std::vector<std::string> const &shard_files,
+                          std::vector<double> const &key) {
+  for (size_t i = 0; i < shard_files.size(); ++i) {
+    auto phases = std::vector<std::vector<T>>();
+    if (!read_records(shard_files[i], shard_key(key, i, shard_files.size()), phases))
+      throw std::runtime_error("Shard " + shard_files[i] +
+                               " is missing or has not been finished.");
+    restored.resize(std::max(restored.size(), phases.size()));
+    for (size_t p = 0; p < phases.size(); ++p)
+      restored[p].insert(restored[p].end(), phases[p].begin(), phases[p].end());
+  }
+}
+
+template <typename T> size_t Checkpoint<T>::begin_phase(std::vector<T> &values) {
+  values.clear();
+  if (phase < restored.size())
+    values.swap(restored[phase]);
+  return phase++;
+}
+
+template <typename T> void Checkpoint<T>::store(size_t p, T const *values, size_t n) const {
+  if (file.empty())
+    return;
+  auto ofs = std::ofstream(file, std::ios::binary | std::ios::app);
+  write(ofs, std::uint64_t{p});
+  write(ofs, std::uint64_t{n});
+  ofs.write(reinterpret_cast<char const *>(values), n * sizeof(T));
+  ofs.close();
+  if (!ofs)
+    throw std::runtime_error("Checkpoint " + file + " couldn't be written.");
+}
+
+template <typename T> void Checkpoint<T>::finish() const {
+  auto ofs = std::ofstream(file, std::ios::binary | std::ios::app);
+  write(ofs, finished);
+  write(ofs, std::uint64_t{0});
+  ofs.close();
+  if (!ofs)
+    throw std::runtime_error("Checkpoint " + file + " couldn't be written.");
+}
+
+template <typename T> void Checkpoint<T>::remove() const { std::remove(file.c_str()); }
+
+} // namespace detail
+} // namespace cubic_splines
+
+template class cubic_splines::detail::Checkpoint<float>;
+template class cubic_splines::detail::Checkpoint<double>;
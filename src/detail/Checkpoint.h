@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace cubic_splines {
+namespace detail {
+
+/**
+ * @brief Append only record of the function values sampled during a build.
+ * The sampling phases of a build are numbered in the order they are started
+ * and the values of every phase are appended in the order of its tasks, so a
+ * build resumed with the same definition skips the tasks which have been
+ * completed before. The file starts with a key of the build, a checkpoint
+ * with a different key or an incomplete record at its end is discarded. The
+ * complete records are never rewritten, so a build which is killed at any
+ * point keeps them.
+ *
+ * A build can be split into shards, every shard samples a contiguous range of
+ * the tasks of every phase and records them in a file of its own. The records
+ * of the shards are combined in the order of the shards.
+ */
+template <typename T> class Checkpoint {
+  std::string file;
+  size_t shard = 0, shards = 1;
+  size_t phase = 0;                      // next phase to be started
+  std::vector<std::vector<T>> restored; // values of the phases read from the file
+
+public:
+  Checkpoint(std::string file, std::vector<double> const &key, size_t shard = 0,
+             size_t shards = 1);
+
+  /**
+   * @brief Combine the records of the files of all shards of a build, which
+   * have to be finished. Values are not stored by the combined checkpoint.
+   */
+  Checkpoint(std::vector<std::string> const &shard_files, std::vector<double> const &key);
+
+  bool sharded() const { return shards > 1; }
+
+  /**
+   * @brief First and last task of *n* tasks which belong to the shard.
+   */
+  std::array<size_t, 2> tasks(size_t n) const {
+    return {n * shard / shards, n * (shard + 1) / shards};
+  }
+
+  /**
+   * @brief Start the next phase and take the values which have been sampled
+   * in it before.
+   */
+  size_t begin_phase(std::vector<T> &values);
+
+  /**
+   * @brief Append *n* values of the phase to the file.
+   */
+  void store(size_t phase, T const *values, size_t n) const;
+
+  /**
+   * @brief Mark the records as complete after all phases have been sampled.
+   */
+  void finish() const;
+
+  /**
+   * @brief Delete the file after the build has been completed.
+   */
+  void remove() const;
+};
+
+} // namespace detail
+} // namespace cubic_splines
@@ -1,9 +1,15 @@
 #include "CubicInterpolation/CubicSplines.h"
 #include "CubicInterpolation/InterpolantBuilder.h"
+#include "detail/BSpline.h"
+#include "detail/FiniteDifference.h"
+#include "detail/Sampling.h"
+#include "detail/Statistics.h"
 
-#include <boost/math/differentiation/finite_difference.hpp>
-#include <boost/math/interpolators/cardinal_cubic_b_spline.hpp>
+#include <algorithm>
 #include <boost/serialization/access.hpp>
+#include <cmath>
+#include <limits>
+#include <numeric>
 #include <vector>
 
 namespace cubic_splines {
@@ -37,70 +43,162 @@ public:
   }
 };
 
-template <typename T>
-struct CubicSplines<T>::RuntimeData : public CubicSplines<T>::StorageData {
+/**
+ * @brief Sample the function at the nodes and approximate the derivates at
+ * the boundaries.
+ */
+template <typename T1, typename T = typename T1::type>
+typename T1::StorageData build_storage_data(typename T1::Definition const &def) {
+  auto n = def.axis->required_nodes();
+  auto low = detail::FiniteDifference<T>(0);
+  auto up = detail::FiniteDifference<T>(n - 1);
+  // the nodes are sampled together with the stencils of the boundary
+  // derivatives
+  auto t = std::vector<T>(n);
+  std::iota(t.begin(), t.end(), T(0));
+  for (auto fd : {low, up})
+    for (auto ti : fd.stencil())
+      t.push_back(ti);
+  auto x = std::vector<T>(t.size());
+  for (size_t k = 0; k < t.size(); ++k)
+    x[k] = def.axis->back_transform(t[k]);
+  auto y = std::vector<T>(x.size());
+  detail::PhaseTimer phase(def.statistics, "nodes");
+  detail::sample(def, std::array<T const *, 1>{x.data()}, y.data(), y.size());
+  phase.stop();
+  auto diff_low = low.derivative(y.data() + n);
+  auto diff_up = up.derivative(y.data() + n + low.n_points);
+  y.resize(n);
+  return typename T1::StorageData(y, diff_low, diff_up);
+}
 
-  boost::math::interpolators::cardinal_cubic_b_spline<T> spline;
+/**
+ * @brief Interpolation tables during runtime. Only the coefficients of the
+ * B-spline are kept, the function values are dropped after the coefficients
+ * have been calculated.
+ */
+template <typename T> struct CubicSplines<T>::RuntimeData {
+  std::vector<T> coefficients; // n + 2 B-spline coefficients of n nodes
 
   RuntimeData() = default;
 
   template <typename T1>
-  RuntimeData(T1 _data, T _lower_lim_derivate, T _upper_lim_derivate)
-      : StorageData(_data, _lower_lim_derivate, _upper_lim_derivate),
-        spline(_data.data(), _data.size(), 0, 1, _lower_lim_derivate,
-               _upper_lim_derivate) {}
+  RuntimeData(T1 const &_y, T _lower_lim_derivate, T _upper_lim_derivate)
+      : coefficients(detail::bspline_coefficients(_y.data(), _y.size(),
+                                                  _lower_lim_derivate,
+                                                  _upper_lim_derivate)) {}
+
+  size_t nodes() const { return coefficients.size() - 2; }
 
-  auto to_storage_data() const { return StorageData(*this); };
+  size_t memory() const { return sizeof(T) * coefficients.capacity(); }
+
+  T evaluate(T x, int d) const {
+    return detail::bspline_evaluate(coefficients.data(), nodes(), x, d);
+  }
+
+  void cell(size_t i, T *p) const { detail::bspline_cell(coefficients.data() + i, p); }
+
+  /**
+   * @brief Value and derivatives at *x* from a single cell lookup.
+   */
+  Derivatives<T, 1> evaluate_with_derivatives(T x, bool second) const {
+    T u, b[4];
+    auto c = coefficients.data() + detail::bspline_locate(nodes(), x, u);
+    auto r = Derivatives<T, 1>();
+    detail::bspline_basis(u, 0, b);
+    r.value = detail::bspline_combine(c, b);
+    detail::bspline_basis(u, 1, b);
+    r.gradient[0] = detail::bspline_combine(c, b);
+    if (second) {
+      detail::bspline_basis(u, 2, b);
+      r.hessian[0] = detail::bspline_combine(c, b);
+    }
+    return r;
+  }
 };
 
 template <typename T>
 CubicSplines<T>::CubicSplines(CubicSplines::RuntimeData _data)
-    : data(::std::make_unique<CubicSplines::RuntimeData>(_data)) {}
+    : data(::std::make_shared<CubicSplines::RuntimeData>(std::move(_data))) {}
 
 template <typename T>
 CubicSplines<T>::CubicSplines(Definition const &def, std::string path,
                               std::string filename) {
+  auto stats = def.statistics;
   try {
+    detail::PhaseTimer phase(stats, "load");
     auto storage_data = load<CubicSplines>(path, filename);
     *this = CubicSplines(storage_data.to_runtime_data());
+    detail::record_memory(stats, data->memory());
+    if (stats)
+      stats->serialized_bytes += fs::file_size(fs::path(path) / filename);
+    phase.stop();
   } catch (std::system_error const &ex) {
     if (ex.code().value() != ENOENT)
       throw(ex);
-    *this = CubicSplines(def);
-    save(data->to_storage_data(), path, filename);
+    auto storage_data = build_storage_data<CubicSplines>(def);
+    *this = CubicSplines(def, storage_data);
+    detail::PhaseTimer phase(stats, "save");
+    if (save(storage_data, path, filename) && stats)
+      stats->serialized_bytes += fs::file_size(fs::path(path) / filename);
+    phase.stop();
   }
 }
 
 template <typename T>
-CubicSplines<T>::CubicSplines(Definition const &def)
-    : data(::std::make_unique<CubicSplines::RuntimeData>()) {
-  using boost::math::differentiation::finite_difference_derivative;
-  auto func = [&def](T x) {
-    auto fx = def.f(x);
-    if (def.f_trafo)
-      fx = def.f_trafo->transform(fx);
-    return fx;
-  };
-  auto y = std::vector<T>(def.axis->required_nodes());
-  for (size_t n = 0; n < y.size(); ++n)
-    y[n] = func(def.axis->back_transform(n));
-  auto f_derivate = [func, axis = def.axis.get()](T t) {
-    return func(axis->back_transform(t));
-  };
-  auto diff_low = finite_difference_derivative(f_derivate, static_cast<T>(0));
-  auto diff_up = finite_difference_derivative(f_derivate, static_cast<T>(y.size() - 1));
-  data = ::std::make_unique<CubicSplines::RuntimeData>(y, diff_low, diff_up);
+CubicSplines<T>::CubicSplines(Definition const &def, StorageData const &storage_data) {
+  detail::PhaseTimer phase(def.statistics, "splines");
+  *this = CubicSplines(storage_data.to_runtime_data());
+  detail::record_memory(def.statistics, data->memory());
+  phase.stop();
 }
 
-template <typename T> T CubicSplines<T>::evaluate(T x) const { return data->spline(x); };
+template <typename T>
+CubicSplines<T>::CubicSplines(Definition const &def)
+    : CubicSplines(def, build_storage_data<CubicSplines>(def)) {}
+
+template <typename T> void CubicSplines<T>::Cursor::seek(T x) {
+  auto last = static_cast<T>(data->nodes() - 2);
+  auto n = node;
+  if (low <= high && x >= high && x < high + 1)
+    n += 1;
+  else if (low <= high && x < low && x >= low - 1)
+    n -= 1;
+  else
+    n = std::max(T(0), std::min(std::floor(x), last));
+  node = n;
+  low = n > 0 ? n : -std::numeric_limits<T>::infinity();
+  high = n < last ? n + 1 : std::numeric_limits<T>::infinity();
+  data->cell(static_cast<size_t>(n), c.data());
+}
 
-template <typename T> T CubicSplines<T>::prime(T x) const {
-  return data->spline.prime(x);
+template <typename T> T CubicSplines<T>::evaluate(T x) const {
+  return data->evaluate(x, 0);
 };
 
+template <typename T>
+void CubicSplines<T>::evaluate(T const *x, T *out, size_t n) const {
+  auto const &spline = *data;
+  for (size_t i = 0; i < n; ++i)
+    out[i] = spline.evaluate(x[i], 0);
+}
+
+template <typename T> T CubicSplines<T>::prime(T x) const { return data->evaluate(x, 1); };
+
+template <typename T> void CubicSplines<T>::prime(T const *x, T *out, size_t n) const {
+  auto const &spline = *data;
+  for (size_t i = 0; i < n; ++i)
+    out[i] = spline.evaluate(x[i], 1);
+}
+
 template <typename T> T CubicSplines<T>::double_prime(T x) const {
-  return data->spline.double_prime(x);
+  return data->evaluate(x, 2);
 };
+
+template <typename T>
+Derivatives<T, 1> CubicSplines<T>::evaluate_with_derivatives(T x, bool second) const {
+  return data->evaluate_with_derivatives(x, second);
+}
 } // namespace cubic_splines
 
 template class cubic_splines::CubicSplines<float>;
@@ -0,0 +1,131 @@
+#include "CubicInterpolation/Executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cubic_splines {
+namespace {
+
+/**
+ * @brief Tasks handed to the executor at once. The tasks are claimed one by
+ * one by the threads working on the job, after an exception the remaining
+ * tasks are skipped.
+ */
+struct Job {
+  size_t n;
+  std::function<void(size_t)> const &task;
+  std::atomic<size_t> next;
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  size_t workers = 0; // pool threads working on the job, guarded by the pool
+
+  Job(size_t _n, std::function<void(size_t)> const &_task)
+      : n(_n), task(_task), next(0) {}
+
+  void work() {
+    for (auto i = next++; i < n; i = next++) {
+      try {
+        task(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error)
+          error = std::current_exception();
+        next = n; // skip the remaining tasks
+      }
+    }
+  }
+};
+
+/**
+ * @brief Worker threads which are started once and run the tasks of the jobs
+ * until the pool is destructed. The thread submitting a job works on it as
+ * well, so jobs can be submitted concurrently and from within a task without
+ * waiting for a free worker.
+ */
+class ThreadPool {
+  std::mutex mutex;
+  std::condition_variable queued, finished;
+  std::deque<std::shared_ptr<Job>> jobs; // with tasks left to claim
+  bool stop = false;
+  std::vector<std::thread> threads;
+
+  // requires the lock
+  void dequeue(std::shared_ptr<Job> const &job) {
+    auto it = std::find(jobs.begin(), jobs.end(), job);
+    if (it != jobs.end())
+      jobs.erase(it);
+  }
+
+  void worker() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      queued.wait(lock, [this]() { return stop || !jobs.empty(); });
+      if (stop)
+        return;
+      auto job = jobs.front();
+      ++job->workers;
+      lock.unlock();
+      job->work();
+      lock.lock();
+      dequeue(job);
+      if (--job->workers == 0)
+        finished.notify_all();
+    }
+  }
+
+public:
+  explicit ThreadPool(unsigned int workers) {
+    for (unsigned int t = 0; t < workers; ++t)
+      threads.emplace_back([this]() { worker(); });
+  }
+
+  ThreadPool(ThreadPool const &) = delete;
+  ThreadPool &operator=(ThreadPool const &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    queued.notify_all();
+    for (auto &t : threads)
+      t.join();
+  }
+
+  void run(size_t n, std::function<void(size_t)> const &task) {
+    auto job = std::make_shared<Job>(n, task);
+    if (!threads.empty() && n > 1) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(job);
+      }
+      queued.notify_all();
+    }
+    job->work();
+    {
+      // no worker joins the job once it has been removed from the queue
+      std::unique_lock<std::mutex> lock(mutex);
+      dequeue(job);
+      finished.wait(lock, [&]() { return job->workers == 0; });
+    }
+    if (job->error)
+      std::rethrow_exception(job->error);
+  }
+};
+} // namespace
+
+Executor thread_executor(unsigned int threads) {
+  // the calling thread is one of the threads
+  auto pool = std::make_shared<ThreadPool>(std::max(threads, 1u) - 1);
+  return [pool](size_t n, std::function<void(size_t)> const &task) {
+    pool->run(n, task);
+  };
+}
+} // namespace cubic_splines
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+namespace cubic_splines {
+namespace detail {
+
+/**
+ * @brief Sixth order central difference with the step width and stencil of
+ * `boost::math::differentiation::finite_difference_derivative`. The stencil
+ * points are sampled by the caller, which allows to evaluate them together
+ * with other points, and the derivative is combined from the sampled values
+ * in the same order as boost does.
+ */
+template <typename T> struct FiniteDifference {
+  static constexpr size_t n_points = 6;
+
+  T x, h;
+
+  explicit FiniteDifference(T _x)
+      : x(_x), h(std::pow(std::numeric_limits<T>::epsilon() / 168, T(1) / T(7))) {
+    // the step has to be representable at x
+    auto temp = x + h;
+    h = temp - x;
+    if (h == 0)
+      h = std::nextafter(x, std::numeric_limits<T>::max()) - x;
+  }
+
+  std::array<T, n_points> stencil() const {
+    return {x + h, x - h, x - 2 * h, x + 2 * h, x + 3 * h, x - 3 * h};
+  }
+
+  /**
+   * @brief Derivative from the function values at the stencil points, which
+   * are expected every *stride* values.
+   */
+  T derivative(T const *y, size_t stride = 1) const {
+    auto y1 = y[0] - y[stride];
+    auto y2 = y[2 * stride] - y[3 * stride];
+    auto y3 = y[4 * stride] - y[5 * stride];
+    return (y3 + 9 * y2 + 45 * y1) / (60 * h);
+  }
+};
+
+/**
+ * @brief One sided derivative at the boundary of *n* values on a grid with
+ * unit step, which are expected every *stride* values. The derivative at the
+ * first value is calculated if *upper* is false, at the last value otherwise.
+ * The order is four, which matches the spline interpolation, and is lowered
+ * if there are less than five values. A single value has no slope, its
+ * derivative is zero.
+ */
+template <typename T>
+T grid_derivative(T const *y, size_t n, std::ptrdiff_t stride, bool upper) {
+  static constexpr double weights[4][5] = {{-1., 1.},
+                                           {-3. / 2., 2., -1. / 2.},
+                                           {-11. / 6., 3., -3. / 2., 1. / 3.},
+                                           {-25. / 12., 4., -3., 4. / 3., -1. / 4.}};
+  if (n < 2)
+    return T(0);
+  auto order = std::min<std::ptrdiff_t>(n - 1, 4);
+  if (upper) {
+    y += (static_cast<std::ptrdiff_t>(n) - 1) * stride;
+    stride = -stride;
+  }
+  auto res = T(0);
+  for (std::ptrdiff_t k = 0; k <= order; ++k)
+    res += static_cast<T>(weights[order - 1][k]) * y[k * stride];
+  return upper ? -res : res;
+}
+
+/**
+ * @brief Finite difference stencils of the derivatives at a node of a two
+ * dimensional table, given in the transformed coordinates of the axes. The
+ * mixed derivative is the derivative along the second axis of the derivatives
+ * along the first axis, its stencil is stored with the first axis running
+ * fastest. The stencil points are written to `x` in the coordinates of the
+ * function.
+ */
+template <typename T, typename A> struct NodeStencils {
+  static constexpr size_t n = FiniteDifference<T>::n_points;
+
+  // points of the derivatives along both axes and of the mixed derivative
+  static constexpr size_t n_derivatives = n * (n + 2);
+
+  A const &ax0, &ax1;
+
+  void prime0(T t0, T t1, std::array<T *, 2> x) const {
+    auto stencil = FiniteDifference<T>(t0).stencil();
+    for (size_t i = 0; i < n; ++i) {
+      x[0][i] = ax0.back_transform(stencil[i]);
+      x[1][i] = ax1.back_transform(t1);
+    }
+  }
+
+  void prime1(T t0, T t1, std::array<T *, 2> x) const {
+    auto stencil = FiniteDifference<T>(t1).stencil();
+    for (size_t i = 0; i < n; ++i) {
+      x[0][i] = ax0.back_transform(t0);
+      x[1][i] = ax1.back_transform(stencil[i]);
+    }
+  }
+
+  void mixed(T t0, T t1, std::array<T *, 2> x) const {
+    auto stencil0 = FiniteDifference<T>(t0).stencil();
+    auto stencil1 = FiniteDifference<T>(t1).stencil();
+    for (size_t j = 0; j < n; ++j) {
+      for (size_t i = 0; i < n; ++i) {
+        x[0][n * j + i] = ax0.back_transform(stencil0[i]);
+        x[1][n * j + i] = ax1.back_transform(stencil1[j]);
+      }
+    }
+  }
+
+  T mixed_derivative(T t0, T t1, T const *v) const {
+    auto fd0 = FiniteDifference<T>(t0);
+    auto dydx = std::array<T, n>();
+    for (size_t j = 0; j < n; ++j)
+      dydx[j] = fd0.derivative(v + n * j);
+    return FiniteDifference<T>(t1).derivative(dydx.data());
+  }
+
+  void derivatives(T t0, T t1, std::array<T *, 2> x) const {
+    prime0(t0, t1, x);
+    prime1(t0, t1, {x[0] + n, x[1] + n});
+    mixed(t0, t1, {x[0] + 2 * n, x[1] + 2 * n});
+  }
+
+  /**
+   * @brief Both derivatives and the mixed one from the values at the points of
+   * derivatives.
+   */
+  std::array<T, 3> derivatives(T t0, T t1, T const *v) const {
+    return {FiniteDifference<T>(t0).derivative(v),
+            FiniteDifference<T>(t1).derivative(v + n), mixed_derivative(t0, t1, v + 2 * n)};
+  }
+};
+} // namespace detail
+} // namespace cubic_splines
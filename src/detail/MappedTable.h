@@ -0,0 +1,187 @@
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cubic_splines {
+namespace detail {
+
+inline bool little_endian() {
+  auto one = std::uint16_t{1};
+  char first;
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+// value of the little endian bytes at p
+template <typename V> V from_little_endian(char const *p) {
+  char bytes[sizeof(V)];
+  std::memcpy(bytes, p, sizeof(V));
+  if (!little_endian())
+    std::reverse(bytes, bytes + sizeof(V));
+  auto v = V();
+  std::memcpy(&v, bytes, sizeof(V));
+  return v;
+}
+
+template <typename V> void to_little_endian(V v, char *p) {
+  std::memcpy(p, &v, sizeof(V));
+  if (!little_endian())
+    std::reverse(p, p + sizeof(V));
+}
+
+/**
+ * @brief Table file which is mapped into memory instead of being read. The
+ * file starts with a header of 64 bytes, holding a magic string, the version,
+ * the size of the stored floating point type, the nodes along both axes, the
+ * values per node record, the offset and the number of the values. The node
+ * records follow at the offset, which is aligned to 64 bytes, with the first
+ * axis fastest. All numbers are stored little endian.
+ *
+ * On little endian machines the records of the stored precision are used in
+ * place, so only the pages which are accessed are read and processes using
+ * the same table share the page cache. Otherwise the records are converted
+ * into a copy.
+ */
+template <typename S> class MappedTable {
+  static constexpr char magic[8] = {'C', 'U', 'B', 'I', 'C', 'T', 'B', '\0'};
+  static constexpr std::uint32_t version = 1;
+  static constexpr size_t header_bytes = 64;
+
+  boost::interprocess::mapped_region region;
+  std::array<long int, 2> size_ = {0, 0};
+  std::uint32_t precision = 0;
+  size_t n_values = 0;
+  char const *values = nullptr;
+
+public:
+  /**
+   * @brief Whether the file exists and starts with the magic string.
+   */
+  static bool is_table(std::string const &file) {
+    char m[sizeof(magic)];
+    auto ifs = std::ifstream(file, std::ios::binary);
+    return ifs.read(m, sizeof(magic)) && std::memcmp(m, magic, sizeof(magic)) == 0;
+  }
+
+  /**
+   * @brief Map the table file, throws if the header is invalid or the file is
+   * truncated.
+   */
+  MappedTable(std::string const &file, size_t fields) {
+    using namespace boost::interprocess;
+    auto mapping = file_mapping(file.c_str(), read_only);
+    region = mapped_region(mapping, read_only);
+    auto p = static_cast<char const *>(region.get_address());
+    if (region.get_size() < header_bytes || std::memcmp(p, magic, sizeof(magic)) != 0)
+      throw std::runtime_error("Not a table file: " + file);
+    if (from_little_endian<std::uint32_t>(p + 8) != version)
+      throw std::runtime_error("Unsupported version of the table file " + file);
+    precision = from_little_endian<std::uint32_t>(p + 12);
+    size_ = {static_cast<long int>(from_little_endian<std::int64_t>(p + 16)),
+             static_cast<long int>(from_little_endian<std::int64_t>(p + 24))};
+    auto stored_fields = from_little_endian<std::uint64_t>(p + 32);
+    auto offset = from_little_endian<std::uint64_t>(p + 40);
+    n_values = from_little_endian<std::uint64_t>(p + 48);
+    if (precision != sizeof(float) && precision != sizeof(double))
+      throw std::runtime_error("Unknown precision of the interpolation tables.");
+    if (stored_fields != fields ||
+        n_values != fields * static_cast<size_t>(size_[0] * size_[1]) ||
+        region.get_size() < offset + n_values * precision)
+      throw std::runtime_error("Corrupt table file " + file);
+    values = p + offset;
+  }
+
+  MappedTable(MappedTable const &) = delete;
+  MappedTable &operator=(MappedTable const &) = delete;
+
+  std::array<long int, 2> size() const { return size_; }
+
+  /**
+   * @brief Whether the records can be used without a conversion.
+   */
+  bool in_place() const { return precision == sizeof(S) && little_endian(); }
+
+  /**
+   * @brief Records in the mapping, only valid if they are used in place.
+   */
+  S const *records() const { return reinterpret_cast<S const *>(values); }
+
+  /**
+   * @brief Copy *n* values starting with the value *first* to *out*,
+   * converted to the storage precision.
+   */
+  void copy(size_t first, size_t n, S *out) const {
+    if (in_place()) {
+      std::copy_n(records() + first, n, out);
+      return;
+    }
+    auto p = values + first * precision;
+    for (size_t k = 0; k < n; ++k, p += precision)
+      out[k] = precision == sizeof(float) ? static_cast<S>(from_little_endian<float>(p))
+                                          : static_cast<S>(from_little_endian<double>(p));
+  }
+
+  /**
+   * @brief Copy of the records converted to the storage precision.
+   */
+  std::vector<S> copy() const {
+    auto v = std::vector<S>(n_values);
+    copy(0, n_values, v.data());
+    return v;
+  }
+
+  /**
+   * @brief Write *n* values of node records of a table with the given nodes.
+   * The file is written under a temporary name first, so it is either
+   * complete or missing.
+   */
+  static void write(std::string const &file, std::array<long int, 2> size,
+                    size_t fields, S const *records, size_t n) {
+    char header[header_bytes] = {};
+    std::memcpy(header, magic, sizeof(magic));
+    to_little_endian(version, header + 8);
+    to_little_endian(static_cast<std::uint32_t>(sizeof(S)), header + 12);
+    to_little_endian(static_cast<std::int64_t>(size[0]), header + 16);
+    to_little_endian(static_cast<std::int64_t>(size[1]), header + 24);
+    to_little_endian(static_cast<std::uint64_t>(fields), header + 32);
+    to_little_endian(static_cast<std::uint64_t>(header_bytes), header + 40);
+    to_little_endian(static_cast<std::uint64_t>(n), header + 48);
+    auto temp = file + ".tmp";
+    {
+      auto ofs = std::ofstream(temp, std::ios::binary);
+      ofs.write(header, header_bytes);
+      if (little_endian()) {
+        ofs.write(reinterpret_cast<char const *>(records),
+                  static_cast<std::streamsize>(sizeof(S) * n));
+      } else {
+        char bytes[sizeof(S)];
+        for (size_t k = 0; k < n; ++k) {
+          to_little_endian(records[k], bytes);
+          ofs.write(bytes, sizeof(S));
+        }
+      }
+      if (!ofs)
+        throw std::runtime_error("Failed to write the table file " + file);
+    }
+    if (std::rename(temp.c_str(), file.c_str()) != 0)
+      throw std::runtime_error("Failed to write the table file " + file);
+  }
+};
+
+template <typename S> constexpr char MappedTable<S>::magic[8];
+template <typename S> constexpr std::uint32_t MappedTable<S>::version;
+template <typename S> constexpr size_t MappedTable<S>::header_bytes;
+
+} // namespace detail
+} // namespace cubic_splines
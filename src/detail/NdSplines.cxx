@@ -0,0 +1,310 @@
+#include "CubicInterpolation/NdSplines.h"
+#include "CubicInterpolation/InterpolantBuilder.h"
+#include "detail/BSpline.h"
+#include "detail/Sampling.h"
+
+#include <algorithm>
+#include <boost/serialization/access.hpp>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cubic_splines {
+
+template <typename T, size_t Dim> struct NdSplines<T, Dim>::StorageData {
+  std::array<size_t, N> nodes; // number of nodes of every axis
+  std::vector<T> y;            // function values, last axis contiguous
+
+  friend class boost::serialization::access;
+  template <class Archive> void serialize(Archive &ar, const unsigned int) {
+    ar &nodes;
+    ar &y;
+  };
+
+public:
+  StorageData() = default;
+
+  StorageData(std::array<size_t, N> _nodes, std::vector<T> _y)
+      : nodes(_nodes), y(std::move(_y)) {}
+
+  auto to_runtime_data(Layout layout) const { return RuntimeData(nodes, y, layout); }
+};
+
+namespace detail {
+/**
+ * @brief Throw if an axis has too few nodes to estimate the derivatives at
+ * its boundaries.
+ */
+template <size_t N> void check_nodes(std::array<size_t, N> const &nodes) {
+  for (size_t d = 0; d < N; ++d)
+    if (nodes[d] < 5)
+      throw std::invalid_argument("NdSplines require at least 5 nodes per axis, axis " +
+                                  std::to_string(d) + " has " +
+                                  std::to_string(nodes[d]) + ".");
+}
+} // namespace detail
+
+/**
+ * @brief Interpolation tables during runtime. The B-spline coefficients are
+ * calculated as a single tensor with *n_i + 2* entries along the *i*-th axis
+ * and the last axis contiguous. With the tensor layout the *4^N* coefficients
+ * around a cell are read as *4^(N-1)* contiguous runs of four values, with the
+ * cells layout they are copied into a block per cell, the cells ordered with
+ * the last axis contiguous as well.
+ */
+template <typename T, size_t Dim> struct NdSplines<T, Dim>::RuntimeData {
+  static constexpr size_t runs = detail::pow4(N - 1);
+  static constexpr size_t block = detail::pow4(N);
+
+  std::array<size_t, N> nodes;
+  std::array<size_t, N> stride; // of the coefficients, or of the cell blocks
+  std::array<size_t, runs> run_offset;
+  Layout layout = Layout::tensor;
+  std::vector<T> coefficients;
+
+  RuntimeData() = default;
+
+  RuntimeData(std::array<size_t, N> const &_nodes, std::vector<T> const &y,
+              Layout _layout)
+      : nodes(_nodes), layout(_layout), coefficients(y) {
+    detail::check_nodes(nodes);
+    // solve along one axis after the other, the extent grows by two each time
+    auto shape = nodes;
+    for (size_t d = 0; d < N; ++d) {
+      size_t outer = 1, inner = 1;
+      for (size_t i = 0; i < d; ++i)
+        outer *= shape[i];
+      for (size_t i = d + 1; i < N; ++i)
+        inner *= shape[i];
+      auto n = shape[d];
+      auto c = std::vector<T>(outer * (n + 2) * inner);
+      auto nan = std::numeric_limits<T>::quiet_NaN();
+      for (size_t o = 0; o < outer; ++o)
+        for (size_t i = 0; i < inner; ++i) {
+          auto line = detail::bspline_coefficients(coefficients.data() + o * n * inner + i,
+                                                   n, nan, nan, inner);
+          for (size_t k = 0; k < n + 2; ++k)
+            c[(o * (n + 2) + k) * inner + i] = line[k];
+        }
+      coefficients = std::move(c);
+      shape[d] = n + 2;
+    }
+    stride[N - 1] = 1;
+    for (size_t d = N - 1; d-- > 0;)
+      stride[d] = stride[d + 1] * shape[d + 1];
+    for (size_t r = 0; r < runs; ++r) {
+      run_offset[r] = 0;
+      for (size_t d = 0, k = r; d + 1 < N; ++d, k /= 4)
+        run_offset[r] += (k % 4) * stride[N - 2 - d];
+    }
+    if (layout == Layout::cells)
+      to_cells();
+  }
+
+  /**
+   * @brief Copy the coefficients around every cell into its block.
+   */
+  void to_cells() {
+    size_t n_cells = 1;
+    for (size_t d = 0; d < N; ++d)
+      n_cells *= nodes[d] - 1;
+    auto blocks = std::vector<T>(n_cells * block);
+    for (size_t k = 0; k < n_cells; ++k) {
+      size_t offset = 0;
+      for (size_t d = N, i = k; d-- > 0; i /= nodes[d] - 1)
+        offset += (i % (nodes[d] - 1)) * stride[d];
+      for (size_t r = 0; r < runs; ++r)
+        std::copy_n(coefficients.data() + offset + run_offset[r], 4,
+                    blocks.data() + k * block + 4 * r);
+    }
+    coefficients = std::move(blocks);
+    stride[N - 1] = block;
+    for (size_t d = N - 1; d-- > 0;)
+      stride[d] = stride[d + 1] * (nodes[d + 1] - 1);
+  }
+
+  /**
+   * @brief The coefficients around the cell of *x*, copied to *buffer* with
+   * the tensor layout, and replace *x* by the relative coordinates in the
+   * cell. Points out of range are assigned to the boundary cells.
+   */
+  T const *neighborhood(std::array<T, N> &x, T *buffer) const {
+    size_t offset = 0;
+    for (size_t d = 0; d < N; ++d) {
+      auto i = std::floor(x[d]);
+      i = i < 0 ? T(0) : i;
+      i = i > T(nodes[d] - 2) ? T(nodes[d] - 2) : i;
+      x[d] -= i;
+      offset += static_cast<size_t>(i) * stride[d];
+    }
+    if (layout == Layout::cells)
+      return coefficients.data() + offset;
+    for (size_t r = 0; r < runs; ++r) {
+      auto p = coefficients.data() + offset + run_offset[r];
+      for (size_t j = 0; j < 4; ++j)
+        buffer[4 * r + j] = p[j];
+    }
+    return buffer;
+  }
+};
+
+template <typename T, size_t Dim>
+NdSplines<T, Dim>::NdSplines(RuntimeData _data)
+    : data(std::make_shared<RuntimeData>(std::move(_data))) {}
+
+/**
+ * @brief Sample the function on the grid of nodes.
+ */
+template <typename T1, typename T = typename T1::type, size_t N = T1::N>
+typename T1::StorageData build_storage_data(typename T1::Definition const &def) {
+  auto nodes = std::array<size_t, N>();
+  size_t size = 1;
+  for (size_t d = 0; d < N; ++d) {
+    nodes[d] = def.axis[d]->required_nodes();
+    size *= nodes[d];
+  }
+  detail::check_nodes(nodes);
+  auto y = std::vector<T>(size);
+  auto point = [&](size_t k, size_t d) {
+    for (size_t j = N - 1; j > d; --j)
+      k /= nodes[j];
+    return def.axis[d]->back_transform(k % nodes[d]);
+  };
+  if (def.f_batch) {
+    // the points are passed in blocks to bound the memory of the coordinates
+    auto x = std::array<std::vector<T>, N>();
+    auto p = std::array<T const *, N>();
+    for (size_t first = 0; first < size; first += detail::max_batch) {
+      auto n = std::min(detail::max_batch, size - first);
+      for (size_t d = 0; d < N; ++d) {
+        x[d].resize(n);
+        for (size_t k = 0; k < n; ++k)
+          x[d][k] = point(first + k, d);
+        p[d] = x[d].data();
+      }
+      def.f_batch(p, y.data() + first, n);
+    }
+  } else {
+    auto x = std::array<T, N>();
+    for (size_t k = 0; k < size; ++k) {
+      for (size_t d = 0; d < N; ++d)
+        x[d] = point(k, d);
+      y[k] = def.f(x);
+    }
+  }
+  if (def.f_trafo)
+    for (auto &yk : y)
+      yk = def.f_trafo->transform(yk);
+  return typename T1::StorageData(nodes, std::move(y));
+}
+
+template <typename T, size_t Dim>
+NdSplines<T, Dim>::NdSplines(Definition const &def, std::string path,
+                             std::string filename) {
+  try {
+    auto storage_data = load<NdSplines>(path, filename);
+    *this = NdSplines(storage_data.to_runtime_data(def.layout));
+  } catch (std::system_error const &ex) {
+    if (ex.code().value() != ENOENT)
+      throw(ex);
+    auto storage_data = build_storage_data<NdSplines>(def);
+    *this = NdSplines(storage_data.to_runtime_data(def.layout));
+    save(storage_data, path, filename);
+  }
+}
+
+template <typename T, size_t Dim>
+NdSplines<T, Dim>::NdSplines(Definition const &def)
+    : NdSplines(build_storage_data<NdSplines>(def).to_runtime_data(def.layout)) {}
+
+template <typename T, size_t Dim>
+T NdSplines<T, Dim>::evaluate(std::array<T, Dim> const &x) const {
+  T buffer[RuntimeData::block];
+  auto u = x;
+  auto c = data->neighborhood(u, buffer);
+  T basis[N][4];
+  T const *b[N];
+  for (size_t d = 0; d < N; ++d) {
+    detail::bspline_basis(u[d], 0, basis[d]);
+    b[d] = basis[d];
+  }
+  return detail::bspline_contract<N>(c, b);
+}
+
+template <typename T, size_t Dim>
+void NdSplines<T, Dim>::evaluate(T const *x, T *out, size_t n) const {
+  auto p = std::array<T, N>();
+  for (size_t k = 0; k < n; ++k) {
+    std::copy(x + k * N, x + (k + 1) * N, p.begin());
+    out[k] = evaluate(p);
+  }
+}
+
+template <typename T, size_t Dim>
+std::array<T, Dim> NdSplines<T, Dim>::prime(std::array<T, Dim> const &x) const {
+  return evaluate_with_derivatives(x).gradient;
+}
+
+template <typename T, size_t Dim>
+void NdSplines<T, Dim>::prime(T const *x, T *out, size_t n) const {
+  auto p = std::array<T, N>();
+  for (size_t k = 0; k < n; ++k) {
+    std::copy(x + k * N, x + (k + 1) * N, p.begin());
+    auto grad = prime(p);
+    std::copy(grad.begin(), grad.end(), out + k * N);
+  }
+}
+
+template <typename T, size_t Dim>
+Derivatives<T, Dim>
+NdSplines<T, Dim>::evaluate_with_derivatives(std::array<T, Dim> const &x, bool second) const {
+  T buffer[RuntimeData::block];
+  auto u = x;
+  auto c = data->neighborhood(u, buffer);
+  // basis functions and their first and second derivatives of every axis
+  T basis[N][3][4];
+  for (size_t d = 0; d < N; ++d)
+    for (int order = 0; order < (second ? 3 : 2); ++order)
+      detail::bspline_basis(u[d], order, basis[d][order]);
+  auto contract = [&c, &basis](std::array<int, N> const &order) {
+    T const *b[N];
+    for (size_t d = 0; d < N; ++d)
+      b[d] = basis[d][order[d]];
+    return detail::bspline_contract<N>(c, b);
+  };
+  auto r = Derivatives<T, N>();
+  auto order = std::array<int, N>();
+  r.value = contract(order);
+  for (size_t i = 0; i < N; ++i) {
+    order[i] = 1;
+    r.gradient[i] = contract(order);
+    order[i] = 0;
+  }
+  r.hessian.fill(0);
+  if (second) {
+    for (size_t i = 0; i < N; ++i) {
+      order[i] = 2;
+      r.hessian[i] = contract(order);
+      order[i] = 0;
+    }
+    auto k = N;
+    for (size_t i = 0; i < N; ++i)
+      for (size_t j = i + 1; j < N; ++j, ++k) {
+        order[i] = order[j] = 1;
+        r.hessian[k] = contract(order);
+        order[i] = order[j] = 0;
+      }
+  }
+  return r;
+}
+
+} // namespace cubic_splines
+
+template class cubic_splines::NdSplines<float, 2>;
+template class cubic_splines::NdSplines<double, 2>;
+template class cubic_splines::NdSplines<float, 3>;
+template class cubic_splines::NdSplines<double, 3>;
+template class cubic_splines::NdSplines<float, 4>;
+template class cubic_splines::NdSplines<double, 4>;
@@ -0,0 +1,303 @@
+#include "CubicInterpolation/Refinement.h"
+#include "CubicInterpolation/BicubicSplines.h"
+#include "CubicInterpolation/CubicSplines.h"
+#include "detail/Sampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cubic_splines {
+namespace detail {
+
+template <typename T>
+std::array<std::unique_ptr<Axis<T>> *, 1> axis_slots(std::unique_ptr<Axis<T>> &ax) {
+  return {&ax};
+}
+
+template <typename T, size_t N>
+std::array<std::unique_ptr<Axis<T>> *, N>
+axis_slots(std::array<std::unique_ptr<Axis<T>>, N> &ax) {
+  auto p = std::array<std::unique_ptr<Axis<T>> *, N>();
+  for (size_t i = 0; i < N; ++i)
+    p[i] = &ax[i];
+  return p;
+}
+
+/**
+ * @brief Function values of the points which have been sampled during the
+ * refinement. The nodes which are kept and the midpoints which become nodes
+ * on the next level are looked up instead of being evaluated again.
+ */
+template <typename T, size_t N> class SampledPoints {
+  std::map<std::array<T, N>, T> values;
+  std::mutex mutex;
+
+public:
+  bool find(std::array<T, N> const &x, T &y) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = values.find(x);
+    if (it == values.end())
+      return false;
+    y = it->second;
+    return true;
+  }
+
+  void insert(std::array<T, N> const &x, T y) {
+    std::lock_guard<std::mutex> lock(mutex);
+    values.emplace(x, y);
+  }
+
+  // distinct points the function has been evaluated at
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return values.size();
+  }
+
+  /**
+   * @brief Look up the values of *n* points, the points which are missing are
+   * passed to `evaluate(x, y, m)` at once.
+   */
+  template <typename E>
+  void batch(std::array<T const *, N> const &x, T *y, size_t n, E &&evaluate) {
+    auto missing = std::vector<size_t>();
+    for (size_t k = 0; k < n; ++k) {
+      auto p = std::array<T, N>();
+      for (size_t i = 0; i < N; ++i)
+        p[i] = x[i][k];
+      if (!find(p, y[k]))
+        missing.push_back(k);
+    }
+    if (missing.empty())
+      return;
+    auto xm = std::array<std::vector<T>, N>();
+    for (size_t i = 0; i < N; ++i)
+      for (auto k : missing)
+        xm[i].push_back(x[i][k]);
+    auto ym = std::vector<T>(missing.size());
+    auto xp = std::array<T const *, N>();
+    for (size_t i = 0; i < N; ++i)
+      xp[i] = xm[i].data();
+    evaluate(xp, ym.data(), missing.size());
+    for (size_t j = 0; j < missing.size(); ++j) {
+      auto p = std::array<T, N>();
+      for (size_t i = 0; i < N; ++i)
+        p[i] = xm[i][j];
+      y[missing[j]] = ym[j];
+      insert(p, ym[j]);
+    }
+  }
+};
+
+template <typename T>
+std::function<T(T)> memoize(std::function<T(T)> f, SampledPoints<T, 1> &sampled) {
+  return [f, &sampled](T x) {
+    auto y = T();
+    if (!sampled.find({x}, y)) {
+      y = f(x);
+      sampled.insert({x}, y);
+    }
+    return y;
+  };
+}
+
+template <typename T>
+std::function<T(T, T)> memoize(std::function<T(T, T)> f, SampledPoints<T, 2> &sampled) {
+  return [f, &sampled](T x0, T x1) {
+    auto y = T();
+    if (!sampled.find({x0, x1}, y)) {
+      y = f(x0, x1);
+      sampled.insert({x0, x1}, y);
+    }
+    return y;
+  };
+}
+
+template <typename T>
+std::function<void(T const *, T *, size_t)>
+memoize(std::function<void(T const *, T *, size_t)> f, SampledPoints<T, 1> &sampled) {
+  return [f, &sampled](T const *x, T *y, size_t n) {
+    sampled.batch({x}, y, n, [&](std::array<T const *, 1> const &xm, T *ym, size_t m) {
+      f(xm[0], ym, m);
+    });
+  };
+}
+
+template <typename T>
+std::function<void(T const *, T const *, T *, size_t)>
+memoize(std::function<void(T const *, T const *, T *, size_t)> f,
+        SampledPoints<T, 2> &sampled) {
+  return [f, &sampled](T const *x0, T const *x1, T *y, size_t n) {
+    sampled.batch({x0, x1}, y, n, [&](std::array<T const *, 2> const &xm, T *ym, size_t m) {
+      f(xm[0], xm[1], ym, m);
+    });
+  };
+}
+
+/**
+ * @brief Function of the definition which looks up the sampled points until
+ * it is destructed, then the original function is restored.
+ */
+template <typename D, typename P> class MemoizedFunction {
+  D &def;
+  decltype(D::f) f;
+  decltype(D::f_batch) f_batch;
+
+public:
+  MemoizedFunction(D &_def, P &sampled) : def(_def), f(_def.f), f_batch(_def.f_batch) {
+    if (f)
+      def.f = memoize(f, sampled);
+    if (f_batch)
+      def.f_batch = memoize(f_batch, sampled);
+  }
+
+  ~MemoizedFunction() {
+    def.f = std::move(f);
+    def.f_batch = std::move(f_batch);
+  }
+};
+
+template <typename T> T evaluate_at(CubicSplines<T> const &s, std::array<T, 1> const &t) {
+  return s.evaluate(t[0]);
+}
+
+template <typename T, typename S>
+T evaluate_at(BicubicSplines<T, S> const &s, std::array<T, 2> const &t) {
+  return s.evaluate(t[0], t[1]);
+}
+
+/**
+ * @brief Largest deviation of the tables from the function at the midpoints
+ * along the axes flagged in the mask, relative to the tolerance. The cells of
+ * the masked axes which contain a midpoint exceeding the tolerance are flagged
+ * in *failing*.
+ */
+template <typename T1, typename T = typename T1::type, size_t N = T1::N>
+T midpoint_error(T1 const &spline, typename T1::Definition const &def,
+                 std::array<Axis<T> *, N> const &axes, unsigned int mask, T rel,
+                 T abs, std::array<std::vector<bool>, N> &failing) {
+  auto counts = std::array<size_t, N>();
+  auto n = size_t{1};
+  for (size_t k = 0; k < N; ++k) {
+    counts[k] = axes[k]->required_nodes() - ((mask >> k) & 1u);
+    n *= counts[k];
+  }
+  // midpoints in the transformed coordinates, the first axis runs fastest
+  auto t = std::array<std::vector<T>, N>();
+  auto x = std::array<std::vector<T>, N>();
+  for (size_t k = 0; k < N; ++k) {
+    t[k].resize(n);
+    auto stride = size_t{1};
+    for (size_t l = 0; l < k; ++l)
+      stride *= counts[l];
+    auto offset = (mask >> k) & 1u ? T(0.5) : T(0);
+    for (size_t i = 0; i < n; ++i)
+      t[k][i] = static_cast<T>(i / stride % counts[k]) + offset;
+    x[k] = t[k];
+    axes[k]->back_transform_n(x[k].data(), n);
+  }
+  auto xc = std::array<T const *, N>();
+  for (size_t k = 0; k < N; ++k)
+    xc[k] = x[k].data();
+  auto f = std::vector<T>(n);
+  sample(def, xc, f.data(), n);
+
+  auto error = T(0);
+  for (size_t i = 0; i < n; ++i) {
+    auto ti = std::array<T, N>();
+    for (size_t k = 0; k < N; ++k)
+      ti[k] = t[k][i];
+    auto s = evaluate_at(spline, ti);
+    auto fi = f[i];
+    if (def.f_trafo) {
+      s = def.f_trafo->back_transform(s);
+      fi = def.f_trafo->back_transform(fi);
+    }
+    auto e = std::abs(s - fi) / (rel * std::abs(fi) + abs);
+    if (e > 1)
+      for (size_t k = 0; k < N; ++k)
+        if ((mask >> k) & 1u)
+          failing[k][static_cast<size_t>(ti[k])] = true;
+    error = std::max(error, e);
+  }
+  return error;
+}
+} // namespace detail
+
+template <typename T1>
+Refinement<T1::N> refine_axes(typename T1::Definition &def,
+                              typename T1::type rel_tolerance,
+                              typename T1::type abs_tolerance, unsigned int max_levels) {
+  using T = typename T1::type;
+  constexpr auto N = T1::N;
+  auto slots = detail::axis_slots(def.axis);
+  detail::SampledPoints<T, N> sampled;
+  detail::MemoizedFunction<typename T1::Definition, detail::SampledPoints<T, N>> memoized(
+      def, sampled);
+  auto res = Refinement<N>();
+  for (res.levels = 0;; ++res.levels) {
+    auto spline = T1(def);
+    auto axes = std::array<Axis<T> *, N>();
+    auto failing = std::array<std::vector<bool>, N>();
+    for (size_t k = 0; k < N; ++k) {
+      axes[k] = slots[k]->get();
+      res.nodes[k] = axes[k]->required_nodes();
+      failing[k].assign(res.nodes[k] - 1, false);
+    }
+    // error of every combination of midpoint coordinates
+    auto error = std::array<T, (1u << N)>();
+    for (unsigned int mask = 1; mask < (1u << N); ++mask)
+      error[mask] = detail::midpoint_error(spline, def, axes, mask, rel_tolerance,
+                                           abs_tolerance, failing);
+    res.error = *std::max_element(error.begin(), error.end());
+    res.converged = res.error <= 1;
+    res.function_evaluations = sampled.size();
+    if (res.converged || res.levels == max_levels)
+      return res;
+
+    // the axes exceeding the tolerance on their own are refined, if the error
+    // only shows up between several axes all of them are refined
+    auto refine = 0u;
+    for (size_t k = 0; k < N; ++k)
+      if (error[1u << k] > 1)
+        refine |= 1u << k;
+    for (unsigned int mask = 1; !refine && mask < (1u << N); ++mask)
+      if (error[mask] > 1)
+        refine = mask;
+    // only the failing cells of those axes are split
+    for (size_t k = 0; k < N; ++k) {
+      if (!((refine >> k) & 1u))
+        continue;
+      auto refined = dynamic_cast<RefinedAxis<T> *>(axes[k]);
+      if (!refined) {
+        auto axis = std::make_unique<RefinedAxis<T>>(std::move(*slots[k]));
+        refined = axis.get();
+        *slots[k] = std::move(axis);
+      }
+      refined->refine(failing[k]);
+    }
+  }
+}
+
+} // namespace cubic_splines
+
+template cubic_splines::Refinement<1>
+cubic_splines::refine_axes<cubic_splines::CubicSplines<double>>(
+    cubic_splines::CubicSplines<double>::Definition &, double, double, unsigned int);
+template cubic_splines::Refinement<1>
+cubic_splines::refine_axes<cubic_splines::CubicSplines<float>>(
+    cubic_splines::CubicSplines<float>::Definition &, float, float, unsigned int);
+template cubic_splines::Refinement<2>
+cubic_splines::refine_axes<cubic_splines::BicubicSplines<double>>(
+    cubic_splines::BicubicSplines<double>::Definition &, double, double, unsigned int);
+template cubic_splines::Refinement<2>
+cubic_splines::refine_axes<cubic_splines::BicubicSplines<float>>(
+    cubic_splines::BicubicSplines<float>::Definition &, float, float, unsigned int);
+template cubic_splines::Refinement<2>
+cubic_splines::refine_axes<cubic_splines::BicubicSplines<double, float>>(
+    cubic_splines::BicubicSplines<double, float>::Definition &, double, double,
+    unsigned int);
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "CubicInterpolation/Executor.h"
+#include "detail/Checkpoint.h"
+#include "detail/Statistics.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace cubic_splines {
+namespace detail {
+
+// batches the points are split into if an executor is set
+constexpr size_t executor_batches = 64;
+
+// points sampled at once by sample_tasks
+constexpr size_t max_batch = size_t{1} << 20;
+
+// blocks sample_tasks is split into at least if the progress is reported or
+// the build is checkpointed
+constexpr size_t progress_steps = 100;
+
+template <typename T, typename D, size_t N, size_t... I>
+size_t sample(D const &def, std::array<T const *, N> const &x, T *y, size_t n,
+            std::index_sequence<I...>) {
+  if (def.f_batch) {
+    auto n_batches = std::min(n, def.executor ? executor_batches : size_t{1});
+    execute(def.executor, n_batches, [&](size_t b) {
+      auto first = n * b / n_batches;
+      auto last = n * (b + 1) / n_batches;
+      def.f_batch((x[I] + first)..., y + first, last - first);
+    });
+  } else {
+    execute(def.executor, n, [&](size_t k) { y[k] = def.f(x[I][k]...); });
+  }
+  if (def.f_trafo)
+    for (size_t k = 0; k < n; ++k)
+      y[k] = def.f_trafo->transform(y[k]);
+  if (def.statistics)
+    def.statistics->function_evaluations += n;
+  return n;
+}
+
+/**
+ * @brief Evaluate the function of the definition at *n* points, the *i*-th
+ * coordinates of the points are expected in `x[i]`, and transform the values
+ * with the trafo of the function values. The batch function is preferred if
+ * it is set, otherwise the points are evaluated one by one. Returns the number
+ * of function evaluations.
+ */
+template <typename T, typename D, size_t N>
+size_t sample(D const &def, std::array<T const *, N> const &x, T *y, size_t n) {
+  return sample(def, x, y, n, std::make_index_sequence<N>());
+}
+
+/**
+ * @brief Sample *n_tasks* tasks of *n_points* points each. The coordinates of
+ * the points of the task *k* are written by `points(k, x)` into the *N*
+ * arrays of `x` and the function values are passed to `combine(k, y)`. The
+ * tasks are processed in blocks to bound the memory of the points, the
+ * progress is reported after every block but the last. With a checkpoint the
+ * values of every block are stored and the tasks completed by a previous run
+ * are combined from the stored values. A sharded checkpoint restricts the
+ * sampling to the tasks of its shard, the other tasks are not combined.
+ * Returns the number of function evaluations.
+ */
+template <typename T, size_t N, typename D, typename P, typename C>
+size_t sample_tasks(D const &def, size_t n_tasks, size_t n_points, P &&points,
+                    C &&combine, Checkpoint<T> *checkpoint = nullptr) {
+  auto range = checkpoint ? checkpoint->tasks(n_tasks) : std::array<size_t, 2>{0, n_tasks};
+  auto first = range[0], last = range[1];
+  auto block = std::max<size_t>(1, max_batch / n_points);
+  if ((def.statistics && def.statistics->progress) || checkpoint)
+    block = std::max<size_t>(1, std::min(block, (last - first) / progress_steps));
+  auto x = std::array<std::vector<T>, N>();
+  auto y = std::vector<T>();
+  auto phase = size_t{0};
+  if (checkpoint) {
+    phase = checkpoint->begin_phase(y);
+    auto restored = std::min(last - first, y.size() / n_points);
+    execute(def.executor, restored,
+            [&](size_t k) { combine(first + k, y.data() + k * n_points); });
+    first += restored;
+  }
+  auto evaluations = size_t{0};
+  for (; first < last; first += block) {
+    auto n = std::min(block, last - first);
+    for (auto &xi : x)
+      xi.resize(n * n_points);
+    y.resize(n * n_points);
+    execute(def.executor, n, [&](size_t k) {
+      auto xk = std::array<T *, N>();
+      for (size_t i = 0; i < N; ++i)
+        xk[i] = x[i].data() + k * n_points;
+      points(first + k, xk);
+    });
+    auto xc = std::array<T const *, N>();
+    for (size_t i = 0; i < N; ++i)
+      xc[i] = x[i].data();
+    evaluations += sample(def, xc, y.data(), n * n_points);
+    if (checkpoint)
+      checkpoint->store(phase, y.data(), y.size());
+    execute(def.executor, n,
+            [&](size_t k) { combine(first + k, y.data() + k * n_points); });
+    if (first + n < last)
+      report_progress(def.statistics,
+                      static_cast<double>(first + n - range[0]) / (last - range[0]));
+  }
+  return evaluations;
+}
+} // namespace detail
+} // namespace cubic_splines
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CubicInterpolation/BuildStatistics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace cubic_splines {
+namespace detail {
+
+/**
+ * @brief Report the completed fraction of the running phase.
+ */
+inline void report_progress(BuildStatistics *stats, double fraction) {
+  if (stats && stats->progress && !stats->phases.empty())
+    stats->progress(stats->phases.back().name, fraction);
+}
+
+/**
+ * @brief Record the memory of the runtime tables if it exceeds the peak.
+ */
+inline void record_memory(BuildStatistics *stats, size_t bytes) {
+  if (stats)
+    stats->peak_memory = std::max(stats->peak_memory, bytes);
+}
+
+/**
+ * @brief Measures the wall time of a build phase from the construction until
+ * stop is called or the timer is destructed. Does nothing without statistics.
+ */
+class PhaseTimer {
+  using clock = std::chrono::steady_clock;
+
+  BuildStatistics *stats;
+  size_t phase = 0;
+  clock::time_point start = clock::now();
+
+public:
+  PhaseTimer(BuildStatistics *_stats, std::string name) : stats(_stats) {
+    if (!stats)
+      return;
+    phase = stats->phases.size();
+    stats->phases.push_back({std::move(name), 0.});
+    report_progress(stats, 0.);
+  }
+
+  PhaseTimer(PhaseTimer const &) = delete;
+  PhaseTimer &operator=(PhaseTimer const &) = delete;
+
+  ~PhaseTimer() {
+    if (stats)
+      stats->phases[phase].seconds = elapsed();
+  }
+
+  double elapsed() const {
+    return std::chrono::duration<double>(clock::now() - start).count();
+  }
+
+  void stop() {
+    if (!stats)
+      return;
+    stats->phases[phase].seconds = elapsed();
+    report_progress(stats, 1.);
+    stats = nullptr;
+  }
+};
+} // namespace detail
+} // namespace cubic_splines
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "CubicInterpolation/BuildStatistics.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace cubic_splines {
+namespace detail {
+
+/**
+ * @brief Partition of a table of *size[0] x size[1]* nodes into square tiles
+ * of `cells x cells` cells, the first axis fastest. A tile holds the nodes of
+ * its cells, so the nodes at the upper borders are shared with the next tile.
+ */
+struct TileGrid {
+  std::array<long int, 2> size = {0, 0};
+  long int cells = 0;
+  std::array<long int, 2> tiles = {0, 0};
+
+  TileGrid() = default;
+  TileGrid(std::array<long int, 2> _size, long int _cells)
+      : size(_size), cells(_cells),
+        tiles{(size[0] - 2) / cells + 1, (size[1] - 2) / cells + 1} {}
+
+  size_t count() const { return static_cast<size_t>(tiles[0] * tiles[1]); }
+
+  // tile of the cell starting at node (n0, n1)
+  size_t tile(unsigned int n0, unsigned int n1) const {
+    return n0 / cells + static_cast<size_t>(tiles[0]) * (n1 / cells);
+  }
+
+  // first node of the tile along both axes
+  std::array<long int, 2> origin(size_t t) const {
+    return {static_cast<long int>(t) % tiles[0] * cells,
+            static_cast<long int>(t) / tiles[0] * cells};
+  }
+
+  // nodes of the tile along both axes
+  std::array<long int, 2> extent(size_t t) const {
+    auto o = origin(t);
+    return {std::min(cells, size[0] - 1 - o[0]) + 1,
+            std::min(cells, size[1] - 1 - o[1]) + 1};
+  }
+};
+
+/**
+ * @brief Tiles which are built on their first access. A built tile is
+ * published through an atomic pointer, so readers of existing tiles never
+ * take a lock. Concurrent first accesses of a tile build it once while the
+ * other readers wait for it, different tiles are built concurrently. If the
+ * build throws, it is retried on the next access.
+ */
+template <typename V> class TileCache {
+  std::function<V(size_t)> build;
+  std::vector<std::atomic<V const *>> published;
+  std::vector<std::once_flag> once;
+  std::vector<std::unique_ptr<V const>> owned;
+
+public:
+  TileCache(size_t n, std::function<V(size_t)> _build)
+      : build(std::move(_build)), published(n), once(n), owned(n) {}
+
+  size_t size() const { return published.size(); }
+
+  /**
+   * @brief The tile if it has been built, nullptr otherwise.
+   */
+  V const *find(size_t i) const { return published[i].load(std::memory_order_acquire); }
+
+  V const &get(size_t i) {
+    if (auto p = find(i))
+      return *p;
+    std::call_once(once[i], [&]() {
+      owned[i] = std::make_unique<V const>(build(i));
+      published[i].store(owned[i].get(), std::memory_order_release);
+    });
+    return *find(i);
+  }
+
+  /**
+   * @brief Add a tile which has been built before, e.g. read from a file.
+   * Must not be called concurrently with other accesses.
+   */
+  void insert(size_t i, V tile) {
+    owned[i] = std::make_unique<V const>(std::move(tile));
+    published[i].store(owned[i].get(), std::memory_order_release);
+  }
+};
+
+/**
+ * @brief Tiles which are read on demand and kept resident up to a budget of
+ * bytes. The tiles are split by their index into shards, each with a mutex and
+ * the order in which its tiles have been used. A query of a resident tile only
+ * locks the shard of the tile, so queries of different shards do not wait for
+ * each other. Tiles are read without a lock, concurrent first queries of a
+ * tile may read it twice. The least recently used tiles of the shards are
+ * evicted in turn, starting with the shard of the read tile, and at least the
+ * last read tile stays resident, even if it exceeds the budget.
+ */
+template <typename V> class LruTileCache {
+  static constexpr size_t n_shards = 16;
+
+  struct Shard {
+    std::mutex mutex;
+    std::list<size_t> recent; // most recently used first
+    size_t hits = 0, misses = 0, evictions = 0;
+  };
+
+  std::function<V(size_t)> read;
+  std::function<size_t(V const &)> bytes;
+  size_t budget;
+  // guarded by the shard of the tile
+  std::vector<std::shared_ptr<V const>> resident;
+  std::vector<std::list<size_t>::iterator> position;
+  std::array<Shard, n_shards> shards;
+  std::atomic<size_t> resident_bytes;
+
+  Shard &shard(size_t i) { return shards[i % n_shards]; }
+
+  // the tile if it is resident, requires the lock of its shard
+  V const *find(size_t i) {
+    if (!resident[i])
+      return nullptr;
+    auto &s = shard(i);
+    ++s.hits;
+    s.recent.splice(s.recent.begin(), s.recent, position[i]);
+    return resident[i].get();
+  }
+
+  std::shared_ptr<V const> load(size_t i) {
+    auto tile = std::make_shared<V const>(read(i));
+    {
+      auto &s = shard(i);
+      std::lock_guard<std::mutex> lock(s.mutex);
+      // a tile published by a concurrent read is a hit
+      if (find(i))
+        return resident[i];
+      ++s.misses;
+      resident[i] = tile;
+      s.recent.push_front(i);
+      position[i] = s.recent.begin();
+      resident_bytes += bytes(*tile);
+    }
+    // a shard is idle if it has no tile besides the kept one
+    for (size_t k = i, idle = 0; resident_bytes > budget && idle < n_shards; ++k) {
+      auto &s = shard(k);
+      std::lock_guard<std::mutex> lock(s.mutex);
+      if (s.recent.empty() || s.recent.back() == i) {
+        ++idle;
+        continue;
+      }
+      idle = 0;
+      auto last = s.recent.back();
+      resident_bytes -= bytes(*resident[last]);
+      resident[last].reset();
+      s.recent.pop_back();
+      ++s.evictions;
+    }
+    return tile;
+  }
+
+public:
+  LruTileCache(size_t n, size_t _budget, std::function<V(size_t)> _read,
+               std::function<size_t(V const &)> _bytes)
+      : read(std::move(_read)), bytes(std::move(_bytes)), budget(_budget), resident(n),
+        position(n), resident_bytes(0) {}
+
+  size_t size() const { return resident.size(); }
+
+  /**
+   * @brief Call `f` with the tile *i* and return its result. A resident tile
+   * is passed under the lock of its shard, so `f` should be short.
+   */
+  template <typename F> auto visit(size_t i, F &&f) {
+    {
+      auto &s = shard(i);
+      std::lock_guard<std::mutex> lock(s.mutex);
+      if (auto tile = find(i))
+        return f(*tile);
+    }
+    return f(*load(i));
+  }
+
+  /**
+   * @brief The tile *i* as shared pointer, so it stays valid while it is used
+   * even if it is evicted.
+   */
+  std::shared_ptr<V const> get(size_t i) {
+    {
+      auto &s = shard(i);
+      std::lock_guard<std::mutex> lock(s.mutex);
+      if (find(i))
+        return resident[i];
+    }
+    return load(i);
+  }
+
+  PageStatistics statistics() {
+    auto stats = PageStatistics();
+    for (auto &s : shards) {
+      std::lock_guard<std::mutex> lock(s.mutex);
+      stats.hits += s.hits;
+      stats.misses += s.misses;
+      stats.evictions += s.evictions;
+    }
+    stats.resident_bytes = resident_bytes;
+    return stats;
+  }
+};
+
+template <typename V> constexpr size_t LruTileCache<V>::n_shards;
+
+} // namespace detail
+} // namespace cubic_splines
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "detail/TileCache.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cubic_splines {
+namespace detail {
+
+/**
+ * @brief File of node records split into the tiles of a TileGrid, so single
+ * tiles can be read without the rest of the table. The header holds a magic
+ * string, the version, the size of the stored floating point type, the nodes,
+ * the cells per tile side and the number of stored tiles followed by their
+ * indices. The records of the stored tiles follow in this order. Every record
+ * consists of *fields* values, the records of a tile are ordered with the
+ * first axis fastest. The values are stored in the byte order of the writing
+ * machine. Files of version 1 store all tiles and no indices.
+ */
+template <typename S, size_t fields> class TileFile {
+  static constexpr char magic[8] = {'C', 'S', 'T', 'I', 'L', 'E', 'S', '\0'};
+  static constexpr std::uint32_t version = 2;
+
+  std::ifstream in;
+  std::mutex mutex; // of the reads from the stream
+  TileGrid grid_;
+  std::vector<std::uint64_t> offsets; // of the tiles in the file, zero if missing
+  size_t stored = 0;
+
+  template <typename V> static void put(std::ofstream &out, V v) {
+    out.write(reinterpret_cast<char const *>(&v), sizeof(V));
+  }
+
+  template <typename V> V get() {
+    auto v = V();
+    in.read(reinterpret_cast<char *>(&v), sizeof(V));
+    return v;
+  }
+
+  size_t bytes(size_t t) const {
+    auto e = grid_.extent(t);
+    return sizeof(S) * fields * static_cast<size_t>(e[0] * e[1]);
+  }
+
+public:
+  /**
+   * @brief Whether the file exists and starts with the magic string.
+   */
+  static bool is_tile_file(std::string const &file) {
+    char m[sizeof(magic)];
+    auto ifs = std::ifstream(file, std::ios::binary);
+    return ifs.read(m, sizeof(magic)) && std::memcmp(m, magic, sizeof(magic)) == 0;
+  }
+
+  /**
+   * @brief Open a tile file for reading, throws if the file is not readable or
+   * has been written with another version or precision.
+   */
+  explicit TileFile(std::string const &file) : in(file, std::ios::binary) {
+    char m[sizeof(magic)];
+    in.read(m, sizeof(magic));
+    if (!in || std::memcmp(m, magic, sizeof(magic)) != 0)
+      throw std::runtime_error("Not a tile file of interpolation tables: " + file);
+    auto v = get<std::uint32_t>();
+    auto precision = get<std::uint32_t>();
+    if ((v != 1 && v != version) || precision != sizeof(S))
+      throw std::runtime_error("Unsupported version or precision of the tile file.");
+    auto s0 = get<std::int64_t>();
+    auto s1 = get<std::int64_t>();
+    auto cells = get<std::int64_t>();
+    if (!in)
+      throw std::runtime_error("Truncated tile file: " + file);
+    grid_ = TileGrid({s0, s1}, cells);
+    auto tiles = std::vector<std::uint64_t>();
+    if (v == 1) {
+      for (size_t t = 0; t < grid_.count(); ++t)
+        tiles.push_back(t);
+    } else {
+      tiles.resize(get<std::uint64_t>());
+      for (auto &t : tiles)
+        t = get<std::uint64_t>();
+    }
+    if (!in)
+      throw std::runtime_error("Truncated tile file: " + file);
+    offsets.assign(grid_.count(), 0);
+    auto offset = static_cast<std::uint64_t>(in.tellg());
+    for (auto t : tiles) {
+      if (t >= grid_.count())
+        throw std::runtime_error("Corrupt tile file " + file);
+      offsets[t] = offset;
+      offset += bytes(t);
+    }
+    stored = tiles.size();
+  }
+
+  TileGrid const &grid() const { return grid_; }
+
+  /**
+   * @brief Whether the tile *t* is stored in the file.
+   */
+  bool contains(size_t t) const { return offsets[t] != 0; }
+
+  /**
+   * @brief Whether every tile of the grid is stored in the file.
+   */
+  bool complete() const { return stored == grid_.count(); }
+
+  /**
+   * @brief Records of the tile *t*, which has to be stored. Concurrent reads
+   * are serialized.
+   */
+  std::vector<S> read(size_t t) {
+    if (!contains(t))
+      throw std::runtime_error("The tile is missing in the tile file.");
+    auto records = std::vector<S>(bytes(t) / sizeof(S));
+    std::lock_guard<std::mutex> lock(mutex);
+    in.seekg(static_cast<std::streamoff>(offsets[t]));
+    in.read(reinterpret_cast<char *>(records.data()),
+            static_cast<std::streamsize>(bytes(t)));
+    if (!in)
+      throw std::runtime_error("Failed to read a tile of the interpolation tables.");
+    return records;
+  }
+
+  /**
+   * @brief Write the given tiles of the grid one after another, `tile(t, r)`
+   * writes the records of the tile *t*, with the first axis fastest, to `r`.
+   * Only a single tile is kept in memory. The file is written under a
+   * temporary name first, so it is either complete or missing.
+   */
+  template <typename F>
+  static void write_by_tile(std::string const &file, TileGrid const &grid,
+                            std::vector<size_t> const &tiles, F &&tile) {
+    auto temp = file + ".tmp";
+    {
+      std::ofstream out(temp, std::ios::binary);
+      out.write(magic, sizeof(magic));
+      put(out, version);
+      put(out, static_cast<std::uint32_t>(sizeof(S)));
+      put(out, static_cast<std::int64_t>(grid.size[0]));
+      put(out, static_cast<std::int64_t>(grid.size[1]));
+      put(out, static_cast<std::int64_t>(grid.cells));
+      put(out, static_cast<std::uint64_t>(tiles.size()));
+      for (auto t : tiles)
+        put(out, static_cast<std::uint64_t>(t));
+      auto records = std::vector<S>();
+      for (size_t k = 0; k < tiles.size() && out; ++k) {
+        auto e = grid.extent(tiles[k]);
+        records.resize(fields * e[0] * e[1]);
+        tile(tiles[k], records.data());
+        out.write(reinterpret_cast<char const *>(records.data()),
+                  static_cast<std::streamsize>(sizeof(S) * records.size()));
+      }
+      if (!out)
+        throw std::runtime_error("Failed to write the tile file " + file);
+    }
+    if (std::rename(temp.c_str(), file.c_str()) != 0)
+      throw std::runtime_error("Failed to write the tile file " + file);
+  }
+
+  /**
+   * @brief Write all tiles of the grid, see above.
+   */
+  template <typename F>
+  static void write_by_tile(std::string const &file, TileGrid const &grid, F &&tile) {
+    auto tiles = std::vector<size_t>(grid.count());
+    for (size_t t = 0; t < tiles.size(); ++t)
+      tiles[t] = t;
+    write_by_tile(file, grid, tiles, std::forward<F>(tile));
+  }
+
+  /**
+   * @brief Write the records of a table, stored with the first axis fastest,
+   * split into the tiles of the grid.
+   */
+  static void write(std::string const &file, TileGrid const &grid, S const *records) {
+    write_by_tile(file, grid, [&](size_t t, S *r) {
+      auto o = grid.origin(t);
+      auto e = grid.extent(t);
+      for (long int j = 0; j < e[1]; ++j)
+        std::copy_n(records + fields * (o[0] + grid.size[0] * (o[1] + j)), fields * e[0],
+                    r + fields * e[0] * j);
+    });
+  }
+};
+
+template <typename S, size_t fields> constexpr char TileFile<S, fields>::magic[8];
+template <typename S, size_t fields> constexpr std::uint32_t TileFile<S, fields>::version;
+
+} // namespace detail
+} // namespace cubic_splines
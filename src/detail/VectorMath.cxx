@@ -0,0 +1,112 @@
+#include "detail/VectorMath.h"
+#include "detail/BicubicKernel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace cubic_splines {
+namespace detail {
+namespace {
+
+// block size, a multiple of every vector width
+constexpr size_t block = 16;
+
+constexpr double inf = std::numeric_limits<double>::infinity();
+constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+constexpr double min_normal = std::numeric_limits<double>::min();
+constexpr double two52 = 4503599627370496.;
+constexpr double two54 = 18014398509481984.;
+constexpr double shifter = 6755399441055744.; // 1.5 * 2^52, rounds to integers
+constexpr uint64_t mantissa = 0x000FFFFFFFFFFFFFu;
+constexpr double sqrt2 = 1.41421356237309504880;
+constexpr double log2e = 1.44269504088896340736;
+// ln(2) splitted into a part with trailing zeros and the remainder
+constexpr double ln2_hi = 6.93147180369123816490e-01;
+constexpr double ln2_lo = 1.90821492927058770002e-10;
+// beyond the limit exp is either zero or infinity
+constexpr double exp_limit = 1100.;
+
+// 1 / (2i + 1), series of atanh
+constexpr double log_coeff[] = {1.,      1. / 3,  1. / 5,  1. / 7,  1. / 9, 1. / 11,
+                                1. / 13, 1. / 15, 1. / 17, 1. / 19, 1. / 21};
+
+// 1 / (i + 1)!, taylor series of expm1 divided by x
+constexpr double exp_coeff[] = {1.,
+                                1. / 2,
+                                1. / 6,
+                                1. / 24,
+                                1. / 120,
+                                1. / 720,
+                                1. / 5040,
+                                1. / 40320,
+                                1. / 362880,
+                                1. / 3628800,
+                                1. / 39916800,
+                                1. / 479001600,
+                                1. / 6227020800};
+
+namespace generic {
+#define CUBIC_SPLINES_TARGET
+#include "detail/VectorMath.inc"
+#undef CUBIC_SPLINES_TARGET
+} // namespace generic
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define CUBIC_SPLINES_X86_SIMD
+
+namespace avx2 {
+#define CUBIC_SPLINES_TARGET __attribute__((target("avx2,fma")))
+#include "detail/VectorMath.inc"
+#undef CUBIC_SPLINES_TARGET
+} // namespace avx2
+
+namespace avx512 {
+#define CUBIC_SPLINES_TARGET __attribute__((target("avx512f")))
+#include "detail/VectorMath.inc"
+#undef CUBIC_SPLINES_TARGET
+} // namespace avx512
+
+#endif
+
+//
+// The SSE4.2 level does not add anything to the SSE2 baseline of x86-64 used
+// by the integer and floatingpoint operations, it is covered by generic.
+//
+
+#ifdef CUBIC_SPLINES_X86_SIMD
+#define CUBIC_SPLINES_DISPATCH(name)                                                    \
+  switch (simd_level()) {                                                              \
+  case SimdLevel::avx512:                                                              \
+    return avx512::apply<avx512::name>(x, n);                                          \
+  case SimdLevel::avx2:                                                                \
+    return avx2::apply<avx2::name>(x, n);                                              \
+  default:                                                                             \
+    return generic::apply<generic::name>(x, n);                                        \
+  }
+#else
+#define CUBIC_SPLINES_DISPATCH(name) return generic::apply<generic::name>(x, n);
+#endif
+
+} // namespace
+
+template <typename T> void log_n(T *x, size_t n) { CUBIC_SPLINES_DISPATCH(log) }
+template <typename T> void log1p_n(T *x, size_t n) { CUBIC_SPLINES_DISPATCH(log1p) }
+template <typename T> void exp_n(T *x, size_t n) { CUBIC_SPLINES_DISPATCH(exp) }
+template <typename T> void expm1_n(T *x, size_t n) { CUBIC_SPLINES_DISPATCH(expm1) }
+
+#undef CUBIC_SPLINES_DISPATCH
+
+template void log_n<double>(double *, size_t);
+template void log_n<float>(float *, size_t);
+template void log1p_n<double>(double *, size_t);
+template void log1p_n<float>(float *, size_t);
+template void exp_n<double>(double *, size_t);
+template void exp_n<float>(float *, size_t);
+template void expm1_n<double>(double *, size_t);
+template void expm1_n<float>(float *, size_t);
+
+} // namespace detail
+} // namespace cubic_splines
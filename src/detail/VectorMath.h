@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+namespace cubic_splines {
+namespace detail {
+
+/**
+ * @brief In place batch versions of the elementary functions used by the axis
+ * transformations. They are evaluated with branch free polynomial
+ * approximations, vectorized for the instruction set of the executing CPU.
+ * The relative error is below a few units in the last place for double and
+ * float arguments within the range of the floatingpoint type.
+ */
+template <typename T> void log_n(T *x, size_t n);
+template <typename T> void log1p_n(T *x, size_t n);
+template <typename T> void exp_n(T *x, size_t n);
+template <typename T> void expm1_n(T *x, size_t n);
+
+} // namespace detail
+} // namespace cubic_splines
@@ -1,11 +1,26 @@
+#include "CubicInterpolation/AsyncInterpolant.h"
 #include "CubicInterpolation/Axis.h"
 #include "CubicInterpolation/BicubicSplines.h"
 #include "CubicInterpolation/Interpolant.h"
+#include "CubicInterpolation/InterpolantBuilder.h"
+#include "CubicInterpolation/Refinement.h"
+#include "detail/BicubicKernel.h"
+#include "detail/FiniteDifference.h"
 #include "gtest/gtest.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <boost/serialization/version.hpp>
 #include <cmath>
+#include <cstdio>
 #include <fstream>
+#include <future>
+#include <limits>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 std::random_device rd;
@@ -14,16 +29,6 @@ std::mt19937 gen(rd());
 using spline_t = cubic_splines::BicubicSplines<double>;
 using spline_def_t = cubic_splines::BicubicSplines<double>::Definition;
 
-class BicubicSplinesTest : public spline_t {
-public:
-  BicubicSplinesTest(spline_def_t const &_def) : spline_t(_def) {}
-
-  template <typename T1>
-  inline auto _prime(Definition const &def, T1 func, unsigned int n1, unsigned int n2) {
-    return spline_t::_prime(def, func, n1, n2);
-  }
-};
-
 TEST(BicubicSplines, evaluate_cubic_polynom) {
   size_t N = 5;
   auto low = 1.f;
@@ -49,6 +54,1138 @@ TEST(BicubicSplines, evaluate_cubic_polynom) {
   }
 };
 
+TEST(BicubicSplines, coefficient_layout) {
+  size_t N = 20;
+  auto low = 1.f;
+  auto high = 10.f;
+  auto func = [](double x1, double x2) { return std::sin(x1) * x2 + x2 * x2; };
+  auto make_def = [&](spline_t::Layout layout) {
+    auto def = spline_def_t();
+    def.f = func;
+    def.approx_derivates = true;
+    def.layout = layout;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+    return def;
+  };
+  auto matrices =
+      cubic_splines::Interpolant<spline_t>(make_def(spline_t::Layout::matrices), "", "");
+  auto coefficients = cubic_splines::Interpolant<spline_t>(
+      make_def(spline_t::Layout::coefficients), "", "");
+  auto nodes =
+      cubic_splines::Interpolant<spline_t>(make_def(spline_t::Layout::nodes), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  for (int i = 0; i < 10'000; ++i) {
+    auto x = std::array<double, 2>{dis(gen), dis(gen)};
+    auto f_matrices = matrices.evaluate(x);
+    EXPECT_NEAR(f_matrices, coefficients.evaluate(x),
+                std::max(std::abs(f_matrices) * 1e-12, 1e-12));
+    EXPECT_NEAR(f_matrices, nodes.evaluate(x),
+                std::max(std::abs(f_matrices) * 1e-12, 1e-12));
+  }
+}
+
+TEST(BicubicSplines, coefficient_layout_storage) {
+  size_t N = 10;
+  auto low = 1.f;
+  auto high = 10.f;
+  auto path = std::string("/tmp");
+  auto filename = std::string("TestBicubicSplines_coefficient_layout_storage.txt");
+  std::remove((path + "/" + filename).c_str());
+  auto func = [](double x1, double x2) { return x1 * x2 + x2 * x2; };
+  auto make_def = [&](spline_t::Layout layout) {
+    auto def = spline_def_t();
+    def.f = func;
+    def.approx_derivates = true;
+    def.layout = layout;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    return def;
+  };
+  auto built = cubic_splines::Interpolant<spline_t>(
+      make_def(spline_t::Layout::coefficients), path, filename);
+  auto loaded = cubic_splines::Interpolant<spline_t>(
+      make_def(spline_t::Layout::matrices), path, filename);
+  auto loaded_nodes =
+      cubic_splines::Interpolant<spline_t>(make_def(spline_t::Layout::nodes), path, filename);
+  std::uniform_real_distribution<double> dis(low, high);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = std::array<double, 2>{dis(gen), dis(gen)};
+    auto f_built = built.evaluate(x);
+    EXPECT_NEAR(f_built, loaded.evaluate(x), std::abs(f_built) * 1e-12);
+    EXPECT_NEAR(f_built, loaded_nodes.evaluate(x), std::abs(f_built) * 1e-12);
+  }
+  std::remove((path + "/" + filename).c_str());
+}
+
+// tables of version 1 store the four node matrices one after another
+struct LegacyStorageData {
+  std::array<long int, 2> size;
+  std::vector<double> y, dydx1, dydx2, d2ydx1dx2;
+
+  template <class Archive> void serialize(Archive &ar, const unsigned int) {
+    auto precision = static_cast<unsigned int>(sizeof(double));
+    ar &size;
+    ar &precision;
+    ar &y;
+    ar &dydx1;
+    ar &dydx2;
+    ar &d2ydx1dx2;
+  }
+};
+
+BOOST_CLASS_VERSION(LegacyStorageData, 1)
+
+TEST(BicubicSplines, legacy_storage) {
+  auto N = 10l;
+  auto path = std::string("/tmp");
+  auto filename = std::string("TestBicubicSplines_legacy_storage.txt");
+  std::remove((path + "/" + filename).c_str());
+  // exact node values and derivatives of f(x0, x1) = x0 * x1 on the nodes
+  auto legacy = LegacyStorageData();
+  legacy.size = {N, N};
+  for (auto n1 = 0l; n1 < N; ++n1) {
+    for (auto n0 = 0l; n0 < N; ++n0) {
+      legacy.y.push_back(n0 * n1);
+      legacy.dydx1.push_back(n1);
+      legacy.dydx2.push_back(n0);
+      legacy.d2ydx1dx2.push_back(1);
+    }
+  }
+  cubic_splines::save(legacy, path, filename);
+  for (auto layout : {spline_t::Layout::matrices, spline_t::Layout::coefficients,
+                      spline_t::Layout::nodes}) {
+    auto def = spline_def_t();
+    def.f = [](double x0, double x1) { return x0 * x1; };
+    def.approx_derivates = true;
+    def.layout = layout;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(0, N - 1, size_t(N));
+    def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(0, N - 1, size_t(N));
+    auto spline = cubic_splines::Interpolant<spline_t>(std::move(def), path, filename);
+    std::uniform_real_distribution<double> dis(0, N - 1);
+    for (int i = 0; i < 100; ++i) {
+      auto x = std::array<double, 2>{dis(gen), dis(gen)};
+      EXPECT_NEAR(x[0] * x[1], spline.evaluate(x), 1e-12 * N * N);
+    }
+  }
+  std::remove((path + "/" + filename).c_str());
+}
+
+TEST(BicubicSplines, batch_evaluation) {
+  size_t N = 20;
+  auto low = 1.f;
+  auto high = 10.f;
+  auto def = spline_def_t();
+  def.f = [](double x1, double x2) { return x1 * x1 * x2 + x2 * x2; };
+  def.approx_derivates = true;
+  def.f_trafo = std::make_unique<cubic_splines::ExpAxis<double>>(1, 0);
+  def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+  def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+  auto spline = cubic_splines::Interpolant<spline_t>(std::move(def), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  auto n = 1'000u;
+  auto x = std::vector<double>(2 * n);
+  for (auto &xi : x)
+    xi = dis(gen);
+  auto f = std::vector<double>(n);
+  auto df = std::vector<double>(2 * n);
+  spline.evaluate(x.data(), f.data(), n);
+  spline.prime(x.data(), df.data(), n);
+  for (size_t i = 0; i < n; ++i) {
+    auto xi = std::array<double, 2>{x[2 * i], x[2 * i + 1]};
+    auto f_i = spline.evaluate(xi);
+    EXPECT_NEAR(f_i, f[i], std::abs(f_i) * 1e-12);
+    auto grad = spline.prime(xi);
+    EXPECT_NEAR(grad[0], df[2 * i], std::abs(grad[0]) * 1e-12);
+    EXPECT_NEAR(grad[1], df[2 * i + 1], std::abs(grad[1]) * 1e-12);
+  }
+}
+
+template <typename T, typename S = T>
+void test_simd_kernel(cubic_splines::detail::CellIndex::Order order) {
+  using cubic_splines::detail::SimdLevel;
+  auto s0 = 13, s1 = 7;
+  auto index = cubic_splines::detail::CellIndex(order, s0, s1);
+  std::uniform_real_distribution<S> dis_c(-1, 1);
+  auto c = std::vector<S>(16 * index.cells());
+  for (auto &ci : c)
+    ci = dis_c(gen);
+  // points outside of the table have to be clamped to the boundary cells
+  std::uniform_real_distribution<T> dis_x0(-0.5, s0 + 0.5);
+  std::uniform_real_distribution<T> dis_x1(-0.5, s1 + 0.5);
+  auto n = 1'003u;
+  auto x = std::vector<T>(2 * n);
+  for (size_t i = 0; i < n; ++i) {
+    x[2 * i] = dis_x0(gen);
+    x[2 * i + 1] = dis_x1(gen);
+  }
+  auto expected = std::vector<T>(n);
+  cubic_splines::detail::bicubic_kernel(SimdLevel::scalar, c.data(), index, x.data(),
+                                        expected.data(), n);
+  for (auto level : {SimdLevel::sse42, SimdLevel::avx2, SimdLevel::avx512}) {
+    if (level > cubic_splines::detail::simd_level())
+      continue;
+    auto out = std::vector<T>(n);
+    cubic_splines::detail::bicubic_kernel(level, c.data(), index, x.data(), out.data(),
+                                          n);
+    for (size_t i = 0; i < n; ++i)
+      EXPECT_NEAR(expected[i], out[i],
+                  std::max<T>(std::abs(expected[i]), 1) * 256 *
+                      std::numeric_limits<T>::epsilon());
+  }
+}
+
+TEST(BicubicSplines, simd_kernel) {
+  using Order = cubic_splines::detail::CellIndex::Order;
+  for (auto order : {Order::column_major, Order::tiled, Order::morton}) {
+    test_simd_kernel<double>(order);
+    test_simd_kernel<float>(order);
+    test_simd_kernel<double, float>(order);
+  }
+}
+
+TEST(BicubicSplines, cell_index) {
+  using Order = cubic_splines::detail::CellIndex::Order;
+  // every cell has to be mapped to a distinct position inside the table
+  for (auto order : {Order::column_major, Order::tiled, Order::morton}) {
+    for (auto s : {std::array<int, 2>{1, 1}, {13, 7}, {8, 64}, {100, 3}}) {
+      auto index = cubic_splines::detail::CellIndex(order, s[0], s[1]);
+      auto used = std::vector<bool>(index.cells(), false);
+      for (auto n1 = 0; n1 < s[1]; ++n1) {
+        for (auto n0 = 0; n0 < s[0]; ++n0) {
+          auto i = index(n0, n1);
+          ASSERT_LT(i, used.size());
+          EXPECT_FALSE(used[i]);
+          used[i] = true;
+        }
+      }
+    }
+  }
+}
+
+TEST(BicubicSplines, cell_order) {
+  size_t N = 30;
+  auto low = 1.e0f;
+  auto high = 1.e2f;
+  auto make_def = [&](spline_t::Layout layout, spline_t::CellOrder order) {
+    auto def = spline_def_t();
+    def.f = [](double x1, double x2) { return std::sin(x1 / 10) * x2 + x2; };
+    def.approx_derivates = true;
+    def.layout = layout;
+    def.cell_order = order;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+    return def;
+  };
+  auto reference = cubic_splines::Interpolant<spline_t>(
+      make_def(spline_t::Layout::matrices, spline_t::CellOrder::column_major), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  auto n = 1'000u;
+  auto x = std::vector<double>(2 * n);
+  for (auto &xi : x)
+    xi = dis(gen);
+  for (auto order : {spline_t::CellOrder::tiled, spline_t::CellOrder::morton}) {
+    auto spline = cubic_splines::Interpolant<spline_t>(
+        make_def(spline_t::Layout::coefficients, order), "", "");
+    auto cursor = spline.cursor();
+    auto out = std::vector<double>(n);
+    spline.evaluate(x.data(), out.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      auto xi = std::array<double, 2>{x[2 * i], x[2 * i + 1]};
+      auto f = reference.evaluate(xi);
+      EXPECT_NEAR(f, spline.evaluate(xi), (std::abs(f) + 1) * 1e-12);
+      EXPECT_NEAR(f, out[i], (std::abs(f) + 1) * 1e-12);
+      EXPECT_NEAR(f, cursor.evaluate(xi), (std::abs(f) + 1) * 1e-12);
+    }
+  }
+}
+
+TEST(BicubicSplines, analytic_derivatives) {
+  size_t N = 11;
+  auto low = 1.e0f;
+  auto high = 1.e1f;
+  auto def = spline_def_t();
+  // a bicubic polynomial is reproduced exactly if the derivatives are exact
+  auto func = [](double x1, double x2) { return x1 * x1 + x2 * x2 + x1 * x2; };
+  auto df_dx = [](double x1, double x2) {
+    return std::array<double, 2>{2 * x1 + x2, 2 * x2 + x1};
+  };
+  def.f = func;
+  def.approx_derivates = false;
+  def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+  def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+  auto axis = cubic_splines::LinAxis<double>(low, high, N);
+  auto spline = spline_t(def);
+  std::uniform_real_distribution<double> dis(low, high);
+  auto stepsize = axis.GetStepsize();
+  for (int i = 0; i < 10'000; ++i) {
+    auto x = std::array<double, 2>{dis(gen), dis(gen)};
+    auto t = std::array<double, 2>{axis.transform(x[0]), axis.transform(x[1])};
+    auto grad = spline.prime(t);
+    auto f = df_dx(x[0], x[1]);
+    EXPECT_NEAR(f[0], grad[0] / stepsize, std::abs(f[0]) * 1e-6);
+    EXPECT_NEAR(f[1], grad[1] / stepsize, std::abs(f[1]) * 1e-6);
+    auto hessian = spline.hessian(t);
+    EXPECT_NEAR(2., hessian[0] / (stepsize * stepsize), 1e-6);
+    EXPECT_NEAR(2., hessian[1] / (stepsize * stepsize), 1e-6);
+    EXPECT_NEAR(1., hessian[2] / (stepsize * stepsize), 1e-6);
+    EXPECT_DOUBLE_EQ(hessian[2], spline.double_prime(t));
+  }
+}
+
+TEST(BicubicSplines, evaluate_with_derivatives) {
+  size_t N = 21;
+  auto low = 1.e0f;
+  auto high = 1.e1f;
+  auto def = spline_def_t();
+  auto func = [](double x1, double x2) { return x1 * x1 + x2 * x2 + x1 * x2; };
+  auto df_dx = [](double x1, double x2) {
+    return std::array<double, 2>{2 * x1 + x2, 2 * x2 + x1};
+  };
+  def.f = func;
+  def.approx_derivates = true;
+  def.f_trafo = std::make_unique<cubic_splines::ExpAxis<double>>(1, 0);
+  def.axis[0] = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+  def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+  auto spline = cubic_splines::Interpolant<spline_t>(std::move(def), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  for (int i = 0; i < 10'000; ++i) {
+    auto x = std::array<double, 2>{dis(gen), dis(gen)};
+    auto res = spline.evaluate_with_derivatives(x, true);
+    EXPECT_DOUBLE_EQ(spline.evaluate(x), res.value);
+    auto grad = spline.prime(x);
+    EXPECT_DOUBLE_EQ(grad[0], res.gradient[0]);
+    EXPECT_DOUBLE_EQ(grad[1], res.gradient[1]);
+    auto f = df_dx(x[0], x[1]);
+    EXPECT_NEAR(f[0], res.gradient[0], std::abs(f[0]) * 1e-2);
+    EXPECT_NEAR(f[1], res.gradient[1], std::abs(f[1]) * 1e-2);
+    EXPECT_NEAR(2., res.hessian[0], 1e-1);
+    EXPECT_NEAR(2., res.hessian[1], 1e-1);
+    EXPECT_NEAR(1., res.hessian[2], 1e-1);
+  }
+}
+
+TEST(BicubicSplines, static_axes) {
+  size_t N = 21;
+  auto low = 1.e0f;
+  auto high = 1.e1f;
+  auto make_def = [&]() {
+    auto def = spline_def_t();
+    def.f = [](double x1, double x2) { return x1 * x1 + x2 * x2 + x1 * x2; };
+    def.f_trafo = std::make_unique<cubic_splines::ExpAxis<double>>(1, 0);
+    def.axis[0] = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+    def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    return def;
+  };
+  using axes_t = cubic_splines::StaticAxes<cubic_splines::ExpAxis<double>,
+                                           cubic_splines::ExpAxis<double>,
+                                           cubic_splines::LinAxis<double>>;
+  auto dynamic = cubic_splines::Interpolant<spline_t>(make_def(), "", "");
+  auto spline = cubic_splines::Interpolant<spline_t, spline_def_t, axes_t>(make_def(), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  auto x = std::vector<double>(2 * 100);
+  for (auto &xi : x)
+    xi = dis(gen);
+  for (size_t k = 0; k < 100; ++k) {
+    auto p = std::array<double, 2>{x[2 * k], x[2 * k + 1]};
+    EXPECT_DOUBLE_EQ(dynamic.evaluate(p), spline.evaluate(p));
+    auto r0 = dynamic.evaluate_with_derivatives(p, true);
+    auto r1 = spline.evaluate_with_derivatives(p, true);
+    for (size_t i = 0; i < 2; ++i)
+      EXPECT_DOUBLE_EQ(r0.gradient[i], r1.gradient[i]);
+    for (size_t i = 0; i < 3; ++i)
+      EXPECT_DOUBLE_EQ(r0.hessian[i], r1.hessian[i]);
+  }
+  auto out0 = std::vector<double>(2 * 100), out1 = std::vector<double>(2 * 100);
+  dynamic.prime(x.data(), out0.data(), 100);
+  spline.prime(x.data(), out1.data(), 100);
+  for (size_t k = 0; k < out0.size(); ++k)
+    EXPECT_DOUBLE_EQ(out0[k], out1[k]);
+
+  using wrong_t = cubic_splines::StaticAxes<cubic_splines::ExpAxis<double>,
+                                            cubic_splines::LinAxis<double>,
+                                            cubic_splines::LinAxis<double>>;
+  using wrong_interpolant_t = cubic_splines::Interpolant<spline_t, spline_def_t, wrong_t>;
+  EXPECT_THROW(wrong_interpolant_t(make_def(), "", ""), std::invalid_argument);
+}
+
+TEST(BicubicSplines, cursor) {
+  size_t N = 30;
+  auto low = 1.e0f;
+  auto high = 1.e2f;
+  for (auto layout : {spline_t::Layout::coefficients, spline_t::Layout::matrices}) {
+    auto def = spline_def_t();
+    def.f = [](double x1, double x2) { return std::sin(x1 / 10) * x2 + x2; };
+    def.approx_derivates = true;
+    def.layout = layout;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+    auto spline = cubic_splines::Interpolant<spline_t>(std::move(def), "", "");
+    auto cursor = spline.cursor();
+    // small steps along a track with occasional jumps and points out of range
+    std::normal_distribution<double> step(0, 1);
+    std::uniform_real_distribution<double> dis(low - 0.5, high + 5);
+    auto x = std::array<double, 2>{50., 50.};
+    for (int i = 0; i < 10'000; ++i) {
+      for (auto &xi : x)
+        xi = i % 100 == 0 ? dis(gen) : std::max(0.5, xi + step(gen));
+      auto f = spline.evaluate(x);
+      EXPECT_NEAR(f, cursor.evaluate(x), std::abs(f) * 1e-12 + 1e-12);
+      auto res = spline.evaluate_with_derivatives(x, true);
+      auto r = cursor.evaluate_with_derivatives(x, true);
+      for (size_t k = 0; k < 2; ++k)
+        EXPECT_NEAR(res.gradient[k], r.gradient[k], std::abs(res.gradient[k]) * 1e-10 + 1e-12);
+      for (size_t k = 0; k < 3; ++k)
+        EXPECT_NEAR(res.hessian[k], r.hessian[k], std::abs(res.hessian[k]) * 1e-10 + 1e-12);
+    }
+  }
+}
+
+TEST(BicubicSplines, mixed_precision) {
+  using mixed_t = cubic_splines::BicubicSplines<double, float>;
+  size_t N = 20;
+  auto low = 1.e0f;
+  auto high = 1.e2f;
+  for (auto layout : {spline_t::Layout::coefficients, spline_t::Layout::matrices}) {
+    auto def = spline_def_t();
+    def.f = [](double x1, double x2) { return std::sin(x1 / 10) * x2 + x2; };
+    def.approx_derivates = true;
+    def.layout = layout;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+    auto mixed_def = mixed_t::Definition();
+    mixed_def.f = def.f;
+    mixed_def.approx_derivates = true;
+    mixed_def.layout = static_cast<mixed_t::Layout>(layout);
+    mixed_def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    mixed_def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+    auto spline = cubic_splines::Interpolant<spline_t>(std::move(def), "", "");
+    auto mixed = cubic_splines::Interpolant<mixed_t>(std::move(mixed_def), "", "");
+    auto cursor = mixed.cursor();
+    std::uniform_real_distribution<double> dis(low, high);
+    auto n = 1'000u;
+    auto x = std::vector<double>(2 * n);
+    for (auto &xi : x)
+      xi = dis(gen);
+    auto out = std::vector<double>(n);
+    mixed.evaluate(x.data(), out.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      auto xi = std::array<double, 2>{x[2 * i], x[2 * i + 1]};
+      auto f = spline.evaluate(xi);
+      EXPECT_NEAR(f, mixed.evaluate(xi), (std::abs(f) + 1) * 1e-5);
+      EXPECT_NEAR(mixed.evaluate(xi), out[i], (std::abs(f) + 1) * 1e-12);
+      EXPECT_NEAR(mixed.evaluate(xi), cursor.evaluate(xi), (std::abs(f) + 1) * 1e-12);
+    }
+  }
+}
+
+TEST(BicubicSplines, mixed_precision_storage) {
+  using mixed_t = cubic_splines::BicubicSplines<double, float>;
+  size_t N = 10;
+  auto low = 1.f;
+  auto high = 10.f;
+  auto path = std::string("/tmp");
+  auto filename = std::string("TestBicubicSplines_mixed_precision_storage.txt");
+  auto make_def = [&](auto def) {
+    def.f = [](double x1, double x2) { return x1 * x2 + x2 * x2; };
+    def.approx_derivates = true;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    return def;
+  };
+  auto reference = cubic_splines::Interpolant<spline_t>(make_def(spline_def_t()), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  // tables written with one precision are converted on load
+  std::remove((path + "/" + filename).c_str());
+  auto written_double =
+      cubic_splines::Interpolant<spline_t>(make_def(spline_def_t()), path, filename);
+  auto loaded_mixed = cubic_splines::Interpolant<mixed_t>(make_def(mixed_t::Definition()),
+                                                          path, filename);
+  std::remove((path + "/" + filename).c_str());
+  auto written_mixed = cubic_splines::Interpolant<mixed_t>(make_def(mixed_t::Definition()),
+                                                           path, filename);
+  auto loaded_double =
+      cubic_splines::Interpolant<spline_t>(make_def(spline_def_t()), path, filename);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = std::array<double, 2>{dis(gen), dis(gen)};
+    auto f = reference.evaluate(x);
+    EXPECT_NEAR(f, written_double.evaluate(x), std::abs(f) * 1e-12);
+    EXPECT_NEAR(f, loaded_mixed.evaluate(x), std::abs(f) * 1e-5);
+    EXPECT_NEAR(f, written_mixed.evaluate(x), std::abs(f) * 1e-5);
+    EXPECT_NEAR(written_mixed.evaluate(x), loaded_double.evaluate(x),
+                std::abs(f) * 1e-12);
+  }
+  std::remove((path + "/" + filename).c_str());
+}
+
+TEST(BicubicSplines, parallel_build) {
+  auto low = 1.e0f;
+  auto high = 1.e1f;
+  auto func = [](double x1, double x2) { return std::sin(x1) * x2 + x2 * x2; };
+  for (auto approx : {true, false}) {
+    auto make_def = [&](cubic_splines::Executor executor) {
+      auto def = spline_def_t();
+      def.f = func;
+      def.approx_derivates = approx;
+      def.executor = std::move(executor);
+      def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, size_t{40});
+      def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, size_t{25});
+      return def;
+    };
+    auto serial = cubic_splines::Interpolant<spline_t>(make_def(nullptr), "", "");
+    auto parallel = cubic_splines::Interpolant<spline_t>(
+        make_def(cubic_splines::thread_executor(4)), "", "");
+    std::uniform_real_distribution<double> dis(low, high);
+    for (int i = 0; i < 1'000; ++i) {
+      auto x = std::array<double, 2>{dis(gen), dis(gen)};
+      EXPECT_EQ(serial.evaluate(x), parallel.evaluate(x));
+      EXPECT_NEAR(func(x[0], x[1]), parallel.evaluate(x), 1e-2);
+    }
+  }
+}
+
+namespace {
+// threads which have evaluated a function, counted once per thread
+std::atomic<unsigned int> evaluating_threads(0);
+struct EvaluatingThread {
+  EvaluatingThread() { ++evaluating_threads; }
+};
+} // namespace
+
+TEST(BicubicSplines, parallel_build_threads) {
+  // the progress splits the sampling into many blocks, all of them are run by
+  // the same workers
+  auto stats = cubic_splines::BuildStatistics();
+  auto blocks = 0u;
+  stats.progress = [&](std::string const &, double) { ++blocks; };
+  auto def = spline_def_t();
+  def.f = [](double x1, double x2) {
+    thread_local EvaluatingThread counted;
+    (void)counted;
+    return std::sin(x1) * x2;
+  };
+  def.approx_derivates = false;
+  def.statistics = &stats;
+  def.executor = cubic_splines::thread_executor(4);
+  def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{40});
+  def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{25});
+  evaluating_threads = 0;
+  spline_t(std::move(def));
+  EXPECT_GT(blocks, 100u);
+  EXPECT_LE(evaluating_threads, 4u);
+}
+
+TEST(BicubicSplines, parallel_build_exception) {
+  auto def = spline_def_t();
+  def.f = [](double x1, double) -> double {
+    if (x1 > 5)
+      throw std::domain_error("out of range");
+    return x1;
+  };
+  def.approx_derivates = true;
+  def.executor = cubic_splines::thread_executor(4);
+  def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{10});
+  def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{10});
+  EXPECT_THROW(spline_t(std::move(def)), std::domain_error);
+}
+
+TEST(BicubicSplines, batch_function) {
+  auto low = 1.e0f;
+  auto high = 1.e1f;
+  auto func = [](double x1, double x2) { return std::sin(x1) * x2 + x2 * x2; };
+  for (auto approx : {true, false}) {
+    auto calls = 0u;
+    auto make_def = [&](bool batch) {
+      auto def = spline_def_t();
+      if (batch)
+        def.f_batch = [&](double const *x0, double const *x1, double *out, size_t n) {
+          ++calls;
+          for (size_t k = 0; k < n; ++k)
+            out[k] = func(x0[k], x1[k]);
+        };
+      else
+        def.f = func;
+      def.approx_derivates = approx;
+      def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(low, high, size_t{40});
+      def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, size_t{25});
+      return def;
+    };
+    auto single = spline_t(make_def(false));
+    auto batch = spline_t(make_def(true));
+    // the nodes and the derivative stencils are sampled in a few batches
+    EXPECT_LE(calls, 3u);
+    std::uniform_real_distribution<double> dis(0, 24);
+    for (int i = 0; i < 1'000; ++i) {
+      auto x = std::array<double, 2>{dis(gen), dis(gen)};
+      EXPECT_EQ(single.evaluate(x), batch.evaluate(x));
+    }
+  }
+}
+
+TEST(BicubicSplines, grid_derivatives) {
+  auto func = [](double x1, double x2) { return std::sin(x1) * x2 + x2 * x2; };
+  auto calls = 0u;
+  auto make_def = [&](spline_t::DerivativeSource derivatives) {
+    auto def = spline_def_t();
+    def.f = [&](double x1, double x2) {
+      ++calls;
+      return func(x1, x2);
+    };
+    def.approx_derivates = true;
+    def.derivatives = derivatives;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{40});
+    def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(1, 10, size_t{25});
+    return def;
+  };
+  auto sampled_def = make_def(spline_t::DerivativeSource::sampled);
+  auto sampled = spline_t(sampled_def);
+  EXPECT_EQ(sampled.function_evaluations(), calls);
+  calls = 0;
+  auto grid_def = make_def(spline_t::DerivativeSource::grid);
+  auto grid = spline_t(grid_def);
+  auto const &ax = grid_def.axis;
+  auto nodes = ax[0]->required_nodes() * ax[1]->required_nodes();
+  EXPECT_EQ(calls, nodes);
+  EXPECT_EQ(grid.function_evaluations(), nodes);
+  EXPECT_GT(sampled.function_evaluations(), nodes);
+  // the stencil is lowered to the available values, a single one has no slope
+  auto y = std::array<double, 2>{1., 3.};
+  EXPECT_EQ(cubic_splines::detail::grid_derivative(y.data(), 2, 1, true), 2.);
+  EXPECT_EQ(cubic_splines::detail::grid_derivative(y.data(), 1, 1, false), 0.);
+
+  // the boundary derivatives only affect the cells close to the boundary, the
+  // tolerance is taken on the scale of the function close to its zeros
+  std::uniform_real_distribution<double> dis0(0, ax[0]->required_nodes() - 1);
+  std::uniform_real_distribution<double> dis1(0, ax[1]->required_nodes() - 1);
+  for (int i = 0; i < 1'000; ++i) {
+    auto t0 = dis0(gen), t1 = dis1(gen);
+    auto f = func(ax[0]->back_transform(t0), ax[1]->back_transform(t1));
+    auto tolerance = 1e-3 * (std::abs(f) + 1);
+    EXPECT_NEAR(f, grid.evaluate(t0, t1), tolerance);
+    EXPECT_NEAR(sampled.evaluate(t0, t1), grid.evaluate(t0, t1), tolerance);
+  }
+}
+
+TEST(BicubicSplines, build_statistics) {
+  auto stats = cubic_splines::BuildStatistics();
+  auto progress = std::vector<std::pair<std::string, double>>();
+  stats.progress = [&](std::string const &phase, double fraction) {
+    progress.emplace_back(phase, fraction);
+  };
+  auto def = spline_def_t();
+  def.f = [](double x1, double x2) { return std::sin(x1) * x2; };
+  def.approx_derivates = true;
+  def.statistics = &stats;
+  def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{40});
+  def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{25});
+  auto spline = spline_t(def);
+  auto phases = std::vector<std::string>();
+  for (auto const &p : stats.phases) {
+    phases.push_back(p.name);
+    EXPECT_GE(p.seconds, 0.);
+  }
+  // the derivatives at the boundaries of both axes are sampled separately
+  EXPECT_EQ(phases, (std::vector<std::string>{"nodes", "derivatives", "derivatives",
+                                              "splines", "layout"}));
+  EXPECT_EQ(stats.function_evaluations, spline.function_evaluations());
+  // the node matrices and the interleaved records coexist
+  auto nodes = def.axis[0]->required_nodes() * def.axis[1]->required_nodes();
+  EXPECT_EQ(stats.peak_memory, 8 * nodes * sizeof(double));
+  EXPECT_EQ(stats.serialized_bytes, 0u);
+
+  // every phase starts at zero and completes with a rising fraction
+  ASSERT_FALSE(progress.empty());
+  for (size_t k = 1; k < progress.size(); ++k)
+    if (progress[k - 1].second < 1.)
+      EXPECT_GE(progress[k].second, progress[k - 1].second);
+    else
+      EXPECT_EQ(progress[k].second, 0.);
+  EXPECT_EQ(progress.back(), std::make_pair(std::string("layout"), 1.));
+}
+
+TEST(BicubicSplines, checkpoint) {
+  auto path = std::string("/tmp");
+  auto filename = std::string("TestBicubicSplines_checkpoint.txt");
+  auto checkpoint = path + "/" + filename + ".checkpoint";
+  std::remove((path + "/" + filename).c_str());
+  std::remove(checkpoint.c_str());
+  auto func = [](double x1, double x2) { return std::sin(x1) * x2 + x2 * x2; };
+  auto calls = 0u;
+  auto limit = std::numeric_limits<unsigned int>::max();
+  auto make_def = [&]() {
+    auto def = spline_def_t();
+    def.f = [&](double x1, double x2) {
+      if (++calls > limit)
+        throw std::runtime_error("walltime exceeded");
+      return func(x1, x2);
+    };
+    def.approx_derivates = true;
+    def.checkpoint = true;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{40});
+    def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(1, 10, size_t{25});
+    return def;
+  };
+  auto uninterrupted = spline_t(make_def());
+  auto total = calls;
+
+  // abort the build in the sampling of the boundary derivatives
+  calls = 0;
+  limit = 1500;
+  EXPECT_THROW(spline_t(make_def(), path, filename), std::runtime_error);
+  EXPECT_TRUE(std::ifstream(checkpoint).good());
+  // an incomplete record of the aborted write is dropped
+  std::ofstream(checkpoint, std::ios::binary | std::ios::app) << "abc";
+
+  calls = 0;
+  limit = std::numeric_limits<unsigned int>::max();
+  auto resumed = spline_t(make_def(), path, filename);
+  EXPECT_LT(calls, total - 1000);
+  EXPECT_FALSE(std::ifstream(checkpoint).good());
+  std::uniform_real_distribution<double> dis(0, 24);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = std::array<double, 2>{dis(gen), dis(gen)};
+    EXPECT_EQ(uninterrupted.evaluate(x), resumed.evaluate(x));
+  }
+  std::remove((path + "/" + filename).c_str());
+
+  // the records are not taken over by a build with another function trafo
+  calls = 0;
+  limit = 1500;
+  EXPECT_THROW(spline_t(make_def(), path, filename), std::runtime_error);
+  calls = 0;
+  limit = std::numeric_limits<unsigned int>::max();
+  auto def = make_def();
+  def.f_trafo = std::make_unique<cubic_splines::ExpM1Axis<double>>(1, 0);
+  spline_t(def, path, filename);
+  EXPECT_EQ(calls, total);
+  std::remove((path + "/" + filename).c_str());
+}
+
+TEST(BicubicSplines, refine_axes) {
+  // linear in the second coordinate, only the first axis requires refinement
+  auto func = [](double x1, double x2) { return std::sin(3 * x1) * (1 + x2); };
+  auto calls = size_t{0};
+  auto def = spline_def_t();
+  def.f = [&](double x1, double x2) {
+    ++calls;
+    return func(x1, x2);
+  };
+  def.approx_derivates = true;
+  def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(0, 3, size_t{5});
+  def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(0, 3, size_t{5});
+  auto rel = 1e-4, abs = 1e-6;
+  auto res = cubic_splines::refine_axes<spline_t>(def, rel, abs);
+  EXPECT_TRUE(res.converged);
+  EXPECT_LE(res.error, 1.);
+  EXPECT_GT(res.nodes[0], 5u);
+  EXPECT_EQ(res.nodes[1], 5u);
+  EXPECT_EQ(def.axis[0]->required_nodes(), res.nodes[0]);
+  // every point is evaluated once, the original function is restored
+  EXPECT_EQ(calls, res.function_evaluations);
+  EXPECT_NE(dynamic_cast<cubic_splines::RefinedAxis<double> *>(def.axis[0].get()), nullptr);
+  EXPECT_EQ(dynamic_cast<cubic_splines::RefinedAxis<double> *>(def.axis[1].get()), nullptr);
+  def.f(1, 1);
+  def.f(1, 1);
+  EXPECT_EQ(calls, res.function_evaluations + 2);
+
+  // the midpoints estimate the error, which is compared on the scale of the
+  // function close to its zeros
+  auto inter = cubic_splines::Interpolant<spline_t>(std::move(def), "", "");
+  std::uniform_real_distribution<double> dis(0, 3);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = std::array<double, 2>{dis(gen), dis(gen)};
+    auto f = func(x[0], x[1]);
+    EXPECT_NEAR(f, inter.evaluate(x), 2 * (rel * std::max(std::abs(f), 1.) + abs));
+  }
+}
+
+TEST(BicubicSplines, async_interpolant) {
+  auto func = [](double x1, double x2) { return std::sin(x1) * x2 + x2 * x2; };
+  // the build is held back until the direct evaluations have been checked
+  auto gate = std::promise<void>();
+  auto opened = gate.get_future().share();
+  auto main_thread = std::this_thread::get_id();
+  auto make_def = [&]() {
+    auto def = spline_def_t();
+    def.f = [=](double x1, double x2) {
+      if (std::this_thread::get_id() != main_thread)
+        opened.wait();
+      return func(x1, x2);
+    };
+    def.approx_derivates = true;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{40});
+    def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(1, 10, size_t{25});
+    return def;
+  };
+  auto async = cubic_splines::AsyncInterpolant<spline_t>(make_def(), "", "",
+                                                         cubic_splines::Pending::direct);
+  EXPECT_FALSE(async.is_ready());
+  std::uniform_real_distribution<double> dis(1, 10);
+  auto x = std::array<double, 2>{dis(gen), dis(gen)};
+  EXPECT_EQ(async.evaluate(x), func(x[0], x[1]));
+  auto out = 0.;
+  async.evaluate(x.data(), &out, 1);
+  EXPECT_EQ(out, func(x[0], x[1]));
+
+  gate.set_value();
+  async.wait();
+  EXPECT_TRUE(async.is_ready());
+  auto blocking = cubic_splines::Interpolant<spline_t>(make_def(), "", "");
+  for (int i = 0; i < 1'000; ++i) {
+    x = std::array<double, 2>{dis(gen), dis(gen)};
+    EXPECT_EQ(async.evaluate(x), blocking.evaluate(x));
+    EXPECT_EQ(async.prime(x), blocking.prime(x));
+  }
+}
+
+TEST(BicubicSplines, async_interpolant_exception) {
+  auto def = spline_def_t();
+  def.f = [](double, double) -> double { throw std::domain_error("out of range"); };
+  def.approx_derivates = true;
+  def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{10});
+  def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{10});
+  auto async = cubic_splines::AsyncInterpolant<spline_t>(std::move(def));
+  EXPECT_THROW(async.evaluate(std::array<double, 2>{2, 2}), std::domain_error);
+  EXPECT_TRUE(async.is_ready());
+}
+
+TEST(BicubicSplines, lazy_tiles) {
+  auto func = [](double x1, double x2) { return std::sin(x1) * x2 + x2 * x2; };
+  std::atomic<size_t> calls(0);
+  auto make_def = [&](bool lazy) {
+    auto def = spline_def_t();
+    def.f = [&](double x1, double x2) {
+      ++calls;
+      return func(x1, x2);
+    };
+    def.approx_derivates = false;
+    def.lazy = lazy;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{100});
+    def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(1, 10, size_t{70});
+    return def;
+  };
+  auto eager_def = make_def(false);
+  auto eager = spline_t(eager_def);
+  auto lazy_def = make_def(true);
+  calls = 0;
+  auto lazy = spline_t(lazy_def);
+  EXPECT_EQ(calls, 0u);
+  // the first tile covers 32 x 32 cells, each node requires 49 points
+  EXPECT_EQ(eager.evaluate(3.5, 7.25), lazy.evaluate(3.5, 7.25));
+  EXPECT_EQ(calls, 33u * 33u * 49u);
+  EXPECT_EQ(eager.evaluate(31.5, 0.5), lazy.evaluate(31.5, 0.5));
+  EXPECT_EQ(calls, 33u * 33u * 49u);
+
+  // tiles are built concurrently by the first evaluations and recorded in the
+  // statistics
+  auto stats = cubic_splines::BuildStatistics();
+  lazy_def.statistics = &stats;
+  calls = 0;
+  auto concurrent = spline_t(lazy_def);
+  auto evaluate = [&](unsigned int seed) {
+    auto g = std::mt19937(seed);
+    auto dis = std::uniform_real_distribution<double>(0, 69);
+    auto equal = true;
+    for (int i = 0; i < 2'000; ++i) {
+      auto x = std::array<double, 2>{dis(g), dis(g)};
+      equal = equal && eager.evaluate(x) == concurrent.evaluate(x);
+    }
+    return equal;
+  };
+  auto futures = std::vector<std::future<bool>>();
+  for (unsigned int t = 0; t < 4; ++t)
+    futures.push_back(std::async(std::launch::async, evaluate, t));
+  for (auto &f : futures)
+    EXPECT_TRUE(f.get());
+  auto tiles = std::count_if(stats.phases.begin(), stats.phases.end(),
+                             [](auto const &p) { return p.name == "tile"; });
+  EXPECT_EQ(tiles, 9);
+  EXPECT_EQ(stats.function_evaluations, calls);
+}
+
+TEST(BicubicSplines, lazy_derivative_sources) {
+  auto make_def = [](bool lazy, spline_t::DerivativeSource derivatives, bool approx) {
+    auto def = spline_def_t();
+    def.f = [](double x1, double x2) { return std::sin(x1) * x2 + x2 * x2; };
+    def.approx_derivates = approx;
+    def.derivatives = derivatives;
+    def.lazy = lazy;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{40});
+    def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{40});
+    return def;
+  };
+  std::uniform_real_distribution<double> dis(0, 39);
+  for (auto source : {spline_t::DerivativeSource::sampled, spline_t::DerivativeSource::grid})
+    for (auto approx : {false, true}) {
+      auto eager_def = make_def(false, source, approx);
+      auto eager = spline_t(eager_def);
+      auto lazy_def = make_def(true, source, approx);
+      // the splines of the derivatives can not be calculated tile by tile
+      if (approx || source != spline_t::DerivativeSource::sampled) {
+        EXPECT_THROW(spline_t{lazy_def}, std::invalid_argument);
+        continue;
+      }
+      auto lazy = spline_t(lazy_def);
+      for (int i = 0; i < 1'000; ++i) {
+        auto x = std::array<double, 2>{dis(gen), dis(gen)};
+        EXPECT_EQ(eager.evaluate(x), lazy.evaluate(x));
+      }
+    }
+}
+
+TEST(BicubicSplines, lazy_write_back) {
+  auto path = std::string("/tmp");
+  auto filename = std::string("TestBicubicSplines_lazy_write_back.txt");
+  std::remove((path + "/" + filename).c_str());
+  auto func = [](double x1, double x2) { return std::cos(x1) * x2; };
+  auto calls = size_t{0};
+  auto make_def = [&](bool lazy) {
+    auto def = spline_def_t();
+    def.f = [&](double x1, double x2) {
+      ++calls;
+      return func(x1, x2);
+    };
+    def.approx_derivates = false;
+    def.lazy = lazy;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{50});
+    def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{40});
+    return def;
+  };
+  auto eager_def = make_def(false);
+  auto eager = spline_t(eager_def);
+  auto total = calls;
+  auto lazy_def = make_def(true);
+  calls = 0;
+  {
+    auto lazy = spline_t(lazy_def, path, filename);
+    EXPECT_EQ(eager.evaluate(40.5, 2.5), lazy.evaluate(40.5, 2.5));
+  }
+  auto built = calls;
+  EXPECT_GT(built, 0u);
+  // the built tiles are stored in a tile file until every tile is built
+  auto magic = [&]() {
+    char m[8] = {};
+    std::ifstream(path + "/" + filename, std::ios::binary).read(m, sizeof(m));
+    return std::string(m);
+  };
+  EXPECT_EQ(magic(), "CSTILES");
+
+  // the stored tile is read back, another one is appended to the file
+  calls = 0;
+  {
+    auto lazy = spline_t(lazy_def, path, filename);
+    EXPECT_EQ(eager.evaluate(40.5, 2.5), lazy.evaluate(40.5, 2.5));
+    EXPECT_EQ(calls, 0u);
+    EXPECT_EQ(eager.evaluate(2.5, 35.5), lazy.evaluate(2.5, 35.5));
+    built += calls;
+  }
+
+  // a complete build only samples the missing tiles and replaces the file
+  calls = 0;
+  auto complete_def = make_def(false);
+  auto complete = spline_t(complete_def, path, filename);
+  // the nodes at the borders of the tiles are sampled twice
+  EXPECT_EQ(built + calls, total + 49 * (51 * 41 - 50 * 40));
+  std::uniform_real_distribution<double> dis(0, 39);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = std::array<double, 2>{dis(gen), dis(gen)};
+    EXPECT_EQ(eager.evaluate(x), complete.evaluate(x));
+  }
+  EXPECT_EQ(magic(), "CUBICTB");
+  calls = 0;
+  auto loaded = spline_t(complete_def, path, filename);
+  EXPECT_EQ(calls, 0u);
+  EXPECT_EQ(eager.evaluate(20.5, 20.5), loaded.evaluate(20.5, 20.5));
+  std::remove((path + "/" + filename).c_str());
+
+  // lazy tables which have built every tile store a table file
+  {
+    auto lazy = spline_t(lazy_def, path, filename);
+    for (auto x1 : {0.5, 35.5})
+      for (auto x0 : {0.5, 35.5, 45.5})
+        EXPECT_EQ(eager.evaluate(x0, x1), lazy.evaluate(x0, x1));
+  }
+  EXPECT_EQ(magic(), "CUBICTB");
+  calls = 0;
+  auto mapped = spline_t(complete_def, path, filename);
+  EXPECT_EQ(calls, 0u);
+  EXPECT_EQ(eager.evaluate(20.5, 20.5), mapped.evaluate(20.5, 20.5));
+  std::remove((path + "/" + filename).c_str());
+}
+
+TEST(BicubicSplines, out_of_core) {
+  auto path = std::string("/tmp");
+  auto filename = std::string("TestBicubicSplines_out_of_core.txt");
+  auto file = path + "/" + filename;
+  std::remove(file.c_str());
+  std::remove((file + ".tiles").c_str());
+  auto calls = 0u;
+  auto make_def = [&](size_t budget) {
+    auto def = spline_def_t();
+    def.f = [&](double x1, double x2) {
+      ++calls;
+      return std::sin(x1) * x2;
+    };
+    def.approx_derivates = true;
+    def.layout = spline_t::Layout::nodes;
+    def.memory_budget = budget;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{100});
+    def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{80});
+    return def;
+  };
+  auto reference = spline_t(make_def(0), path, filename);
+  EXPECT_EQ(reference.page_statistics().misses, 0u);
+
+  // the tiles of a lazy build can not be kept out of core
+  auto lazy_def = make_def(1 << 20);
+  lazy_def.approx_derivates = false;
+  lazy_def.lazy = true;
+  EXPECT_THROW(spline_t(lazy_def, path, filename), std::invalid_argument);
+
+  // a tile of 33 x 33 nodes requires 34848 bytes, two of them fit the budget
+  auto budget = size_t{80'000};
+  calls = 0;
+  auto paged = spline_t(make_def(budget), path, filename);
+  EXPECT_EQ(calls, 0u);
+  std::uniform_real_distribution<double> dis0(0, 99), dis1(0, 79);
+  auto queries = size_t{2'000};
+  for (size_t i = 0; i < queries; ++i) {
+    auto x = std::array<double, 2>{dis0(gen), dis1(gen)};
+    EXPECT_EQ(reference.evaluate(x), paged.evaluate(x));
+  }
+  auto stats = paged.page_statistics();
+  EXPECT_EQ(stats.hits + stats.misses, queries);
+  EXPECT_GT(stats.evictions, 0u);
+  EXPECT_LE(stats.resident_bytes, budget);
+
+  // concurrent queries read and evict tiles of different shards
+  auto evaluate = [&](unsigned int seed) {
+    auto g = std::mt19937(seed);
+    auto equal = true;
+    for (size_t i = 0; i < queries; ++i) {
+      auto x = std::array<double, 2>{dis0(g), dis1(g)};
+      equal = equal && reference.evaluate(x) == paged.evaluate(x);
+    }
+    return equal;
+  };
+  auto futures = std::vector<std::future<bool>>();
+  for (unsigned int t = 0; t < 4; ++t)
+    futures.push_back(std::async(std::launch::async, evaluate, t));
+  for (auto &f : futures)
+    EXPECT_TRUE(f.get());
+  stats = paged.page_statistics();
+  EXPECT_GE(stats.hits + stats.misses, 5 * queries);
+
+  // the tiles are read without the table file
+  std::remove(file.c_str());
+  auto reloaded = spline_t(make_def(budget), path, filename);
+  EXPECT_EQ(reference.evaluate(50.5, 40.5), reloaded.evaluate(50.5, 40.5));
+  EXPECT_EQ(reloaded.page_statistics().misses, 1u);
+  EXPECT_EQ(calls, 0u);
+  std::remove((file + ".tiles").c_str());
+
+  // a build writes the table file first and copies the tiles from it
+  auto built = spline_t(make_def(budget), path, filename);
+  EXPECT_GT(calls, 0u);
+  EXPECT_EQ(reference.evaluate(50.5, 40.5), built.evaluate(50.5, 40.5));
+  EXPECT_EQ(built.page_statistics().misses, 1u);
+  EXPECT_TRUE(std::ifstream(file).good());
+  std::remove(file.c_str());
+  std::remove((file + ".tiles").c_str());
+}
+
+TEST(BicubicSplines, sharded_build) {
+  auto path = std::string("/tmp");
+  auto filename = std::string("TestBicubicSplines_sharded_build.txt");
+  auto file = path + "/" + filename;
+  auto shards = size_t{3};
+  auto calls = 0u;
+  for (auto approx : {true, false}) {
+    std::remove(file.c_str());
+    auto make_def = [&]() {
+      auto def = spline_def_t();
+      def.f = [&](double x1, double x2) {
+        ++calls;
+        return std::sin(x1) * x2 + x2 * x2;
+      };
+      def.approx_derivates = approx;
+      def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{40});
+      def.axis[1] = std::make_unique<cubic_splines::ExpAxis<double>>(1, 10, size_t{25});
+      return def;
+    };
+    calls = 0;
+    auto direct = spline_t(make_def());
+    auto total = calls;
+
+    // the shards are independent of each other and of their order
+    calls = 0;
+    for (auto shard = shards; shard-- > 0;)
+      spline_t::build_shard(make_def(), path, filename, shard, shards);
+    EXPECT_EQ(calls, total);
+    EXPECT_THROW(spline_t::merge_shards(make_def(), path, filename, shards + 1),
+                 std::runtime_error);
+    EXPECT_THROW(spline_t::merge_shards(make_def(), path, filename, 0),
+                 std::invalid_argument);
+    auto lazy_def = make_def();
+    lazy_def.lazy = true;
+    EXPECT_THROW(spline_t::build_shard(lazy_def, path, filename, 0, shards),
+                 std::invalid_argument);
+    EXPECT_THROW(spline_t::build_shard(make_def(), path, filename, shards, shards),
+                 std::invalid_argument);
+
+    // an existing table file is not replaced and the shards are kept
+    std::ofstream(file) << "occupied";
+    EXPECT_THROW(spline_t::merge_shards(make_def(), path, filename, shards),
+                 std::runtime_error);
+    EXPECT_TRUE(std::ifstream(file + ".shard0").good());
+    std::remove(file.c_str());
+
+    calls = 0;
+    auto merged = spline_t::merge_shards(make_def(), path, filename, shards);
+    EXPECT_EQ(calls, 0u);
+    EXPECT_TRUE(std::ifstream(file).good());
+    EXPECT_FALSE(std::ifstream(file + ".shard0").good());
+    std::uniform_real_distribution<double> dis0(0, 39), dis1(0, 24);
+    for (int i = 0; i < 1'000; ++i) {
+      auto x = std::array<double, 2>{dis0(gen), dis1(gen)};
+      EXPECT_EQ(direct.evaluate(x), merged.evaluate(x));
+    }
+  }
+  std::remove(file.c_str());
+}
+
+TEST(BicubicSplines, mapped_table) {
+  auto path = std::string("/tmp");
+  auto filename = std::string("TestBicubicSplines_mapped_table.txt");
+  auto file = path + "/" + filename;
+  std::remove(file.c_str());
+  auto make_def = [&](cubic_splines::BuildStatistics *stats) {
+    auto def = spline_def_t();
+    def.f = [](double x1, double x2) { return std::sin(x1) * x2; };
+    def.approx_derivates = true;
+    def.statistics = stats;
+    def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{30});
+    def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{20});
+    return def;
+  };
+  auto built = spline_t(make_def(nullptr), path, filename);
+  char magic[8] = {};
+  std::ifstream(file, std::ios::binary).read(magic, sizeof(magic));
+  EXPECT_EQ(std::string(magic), "CUBICTB");
+
+  // by default the node records are used in the mapping without a copy
+  auto stats = cubic_splines::BuildStatistics();
+  auto mapped = spline_t(make_def(&stats), path, filename);
+  EXPECT_EQ(stats.peak_memory, 0u);
+  EXPECT_EQ(stats.serialized_bytes, 64 + 4 * 30 * 20 * sizeof(double));
+  std::uniform_real_distribution<double> dis0(0, 29), dis1(0, 19);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = std::array<double, 2>{dis0(gen), dis1(gen)};
+    EXPECT_EQ(built.evaluate(x), mapped.evaluate(x));
+  }
+  std::remove(file.c_str());
+}
+
 /* TEST(BicubicSplines, evaluate_absolute_value) { */
 /*   size_t N = 30; */
 /*   auto low = -10.f; */
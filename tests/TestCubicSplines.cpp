@@ -1,12 +1,26 @@
 
+#include "CubicInterpolation/AsyncInterpolant.h"
 #include "CubicInterpolation/Axis.h"
 #include "CubicInterpolation/CubicSplines.h"
 #include "CubicInterpolation/Interpolant.h"
+#include "CubicInterpolation/Refinement.h"
+#include "detail/BSpline.h"
+#include "detail/FiniteDifference.h"
 #include "gtest/gtest.h"
+#include <boost/math/differentiation/finite_difference.hpp>
+#include <boost/math/interpolators/cardinal_cubic_b_spline.hpp>
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdio>
 #include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <random>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 std::random_device rd;
@@ -188,6 +202,454 @@ TEST(CubicSplines, prime_y_trafo) {
   }
 }
 
+TEST(CubicSplines, batch_evaluation) {
+  size_t N = 30;
+  auto low = 1.e-2f;
+  auto high = 1.e2f;
+  auto def = spline_def_t();
+  def.f = [](double x) { return x * x + x + 1; };
+  def.f_trafo = std::make_unique<cubic_splines::ExpM1Axis<double>>(1, 0);
+  def.axis = std::make_unique<cubic_splines::ExpM1Axis<double>>(low, high, N);
+  auto spline = cubic_splines::Interpolant<spline_t>(std::move(def), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  auto x = std::vector<double>(1'000);
+  for (auto &xi : x)
+    xi = dis(gen);
+  auto f = std::vector<double>(x.size());
+  auto df = std::vector<double>(x.size());
+  spline.evaluate(x.data(), f.data(), x.size());
+  spline.prime(x.data(), df.data(), x.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    auto f_i = spline.evaluate(x[i]);
+    auto df_i = spline.prime(x[i]);
+    EXPECT_NEAR(f_i, f[i], std::abs(f_i) * 1e-12);
+    EXPECT_NEAR(df_i, df[i], std::abs(df_i) * 1e-12);
+  }
+}
+
+TEST(CubicSplines, axis_batch_transform) {
+  auto axes = std::vector<std::unique_ptr<cubic_splines::Axis<double>>>();
+  axes.push_back(std::make_unique<cubic_splines::ExpAxis<double>>(1, 1e14, size_t{100}));
+  axes.push_back(std::make_unique<cubic_splines::ExpM1Axis<double>>(1, 1e14, size_t{100}));
+  axes.push_back(std::make_unique<cubic_splines::ExpM1Axis<double>>(1, 0));
+  std::uniform_real_distribution<double> dis(-5, 14);
+  auto x = std::vector<double>(1'003);
+  for (auto &xi : x)
+    xi = std::pow(10, dis(gen));
+  for (auto const &axis : axes) {
+    auto t = x;
+    axis->transform_n(t.data(), t.size());
+    for (size_t i = 0; i < x.size(); ++i)
+      EXPECT_NEAR(axis->transform(x[i]), t[i], std::abs(t[i]) * 1e-14 + 1e-14);
+    auto y = t;
+    axis->back_transform_n(y.data(), y.size());
+    for (size_t i = 0; i < x.size(); ++i)
+      EXPECT_NEAR(axis->back_transform(t[i]), y[i], std::abs(y[i]) * 1e-14);
+  }
+}
+
+TEST(CubicSplines, evaluate_with_derivatives) {
+  size_t N = 30;
+  auto low = 1.e-2f;
+  auto high = 1.e2f;
+  auto def = spline_def_t();
+  auto func = [](double x) { return x * x + x + 1; };
+  auto df_dx = [](double x) { return 2 * x + 1; };
+  def.f = func;
+  def.f_trafo = std::make_unique<cubic_splines::ExpM1Axis<double>>(1, 0);
+  def.axis = std::make_unique<cubic_splines::ExpM1Axis<double>>(low, high, N);
+  // the error of the estimated boundary derivatives decays over the first
+  // cells, the second derivative is only checked apart from them
+  auto inner_low = def.axis->back_transform(5);
+  auto inner_high = def.axis->back_transform(N - 6);
+  auto spline = cubic_splines::Interpolant<spline_t>(std::move(def), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  std::uniform_real_distribution<double> inner(inner_low, inner_high);
+  for (int i = 0; i < 10'000; ++i) {
+    auto x = dis(gen);
+    auto res = spline.evaluate_with_derivatives(x, true);
+    EXPECT_DOUBLE_EQ(spline.evaluate(x), res.value);
+    EXPECT_NEAR(df_dx(x), res.gradient[0], std::abs(func(x)) * 1e-2);
+    res = spline.evaluate_with_derivatives(inner(gen), true);
+    EXPECT_NEAR(2., res.hessian[0], 2e-1);
+  }
+}
+
+TEST(CubicSplines, static_axes) {
+  size_t N = 50;
+  auto low = 1.e0f;
+  auto high = 1.e2f;
+  auto make_def = [&]() {
+    auto def = spline_def_t();
+    def.f = [](double x) { return x * x; };
+    def.axis = std::make_unique<cubic_splines::ExpM1Axis<double>>(low, high, N);
+    return def;
+  };
+  using axes_t = cubic_splines::StaticAxes<void, cubic_splines::ExpM1Axis<double>>;
+  auto dynamic = cubic_splines::Interpolant<spline_t>(make_def(), "", "");
+  auto spline = cubic_splines::Interpolant<spline_t, spline_def_t, axes_t>(make_def(), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = dis(gen);
+    EXPECT_DOUBLE_EQ(dynamic.evaluate(x), spline.evaluate(x));
+    EXPECT_DOUBLE_EQ(dynamic.prime(x), spline.prime(x));
+  }
+  auto def = make_def();
+  def.f_trafo = std::make_unique<cubic_splines::ExpAxis<double>>(1, 0);
+  using interpolant_t = cubic_splines::Interpolant<spline_t, spline_def_t, axes_t>;
+  EXPECT_THROW(interpolant_t(std::move(def), "", ""), std::invalid_argument);
+}
+
+TEST(CubicSplines, bspline_coefficients) {
+  std::uniform_real_distribution<double> dis(-10, 10);
+  auto y = std::vector<double>(40);
+  for (auto &yi : y)
+    yi = dis(gen);
+  auto nan = std::numeric_limits<double>::quiet_NaN();
+  for (auto d : {std::array<double, 2>{nan, nan}, std::array<double, 2>{1.5, -3.}}) {
+    auto c = cubic_splines::detail::bspline_coefficients(y.data(), y.size(), d[0], d[1]);
+    ASSERT_EQ(y.size() + 2, c.size());
+    // boost estimates the upper derivative at the wrong node, so pass the
+    // one-sided fourth order differences explicitly
+    auto n = y.size();
+    auto d_low = std::isnan(d[0]) ? (-25 * y[0] + 48 * y[1] - 36 * y[2] + 16 * y[3] -
+                                     3 * y[4]) / 12
+                                  : d[0];
+    auto d_up = std::isnan(d[1]) ? (25 * y[n - 1] - 48 * y[n - 2] + 36 * y[n - 3] -
+                                    16 * y[n - 4] + 3 * y[n - 5]) / 12
+                                 : d[1];
+    auto spline = boost::math::interpolators::cardinal_cubic_b_spline<double>(
+        y.data(), y.size(), 0, 1, d_low, d_up);
+    std::uniform_real_distribution<double> dis_x(0, y.size() - 1);
+    for (int i = 0; i < 1'000; ++i) {
+      auto x = dis_x(gen);
+      for (int k = 0; k < 3; ++k) {
+        auto expected = k == 0 ? spline(x) : k == 1 ? spline.prime(x) : spline.double_prime(x);
+        EXPECT_NEAR(expected,
+                    cubic_splines::detail::bspline_evaluate(c.data(), y.size(), x, k),
+                    std::max(std::abs(expected), 1.) * 1e-12);
+      }
+    }
+    for (size_t n = 0; n < y.size(); ++n)
+      EXPECT_NEAR(y[n], cubic_splines::detail::bspline_evaluate(c.data(), y.size(),
+                                                                double(n), 0),
+                  1e-12);
+  }
+}
+
+TEST(CubicSplines, storage) {
+  size_t N = 20;
+  auto low = 1.f;
+  auto high = 10.f;
+  auto path = std::string("/tmp");
+  auto filename = std::string("TestCubicSplines_storage.txt");
+  std::remove((path + "/" + filename).c_str());
+  auto make_def = [&]() {
+    auto def = spline_def_t();
+    def.f = [](double x) { return std::sin(x); };
+    def.axis = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    return def;
+  };
+  auto built = cubic_splines::Interpolant<spline_t>(make_def(), path, filename);
+  auto loaded = cubic_splines::Interpolant<spline_t>(make_def(), path, filename);
+  std::uniform_real_distribution<double> dis(low, high);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = dis(gen);
+    EXPECT_DOUBLE_EQ(built.evaluate(x), loaded.evaluate(x));
+  }
+  std::remove((path + "/" + filename).c_str());
+}
+
+TEST(CubicSplines, bspline_estimated_derivatives) {
+  // the estimated boundary derivatives are exact for a cubic polynom
+  auto func = [](double x) { return x * x * x - 4 * x * x + x; };
+  auto y = std::vector<double>(10);
+  for (size_t n = 0; n < y.size(); ++n)
+    y[n] = func(n);
+  auto nan = std::numeric_limits<double>::quiet_NaN();
+  auto c = cubic_splines::detail::bspline_coefficients(y.data(), y.size(), nan, nan);
+  std::uniform_real_distribution<double> dis(0, y.size() - 1);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = dis(gen);
+    EXPECT_NEAR(func(x), cubic_splines::detail::bspline_evaluate(c.data(), y.size(), x, 0),
+                1e-10);
+  }
+}
+
+TEST(CubicSplines, cursor) {
+  size_t N = 50;
+  auto low = 1.e0f;
+  auto high = 1.e2f;
+  auto def = spline_def_t();
+  def.f = [](double x) { return std::sin(x) + 2; };
+  def.f_trafo = std::make_unique<cubic_splines::ExpAxis<double>>(1, 0);
+  def.axis = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+  auto spline = cubic_splines::Interpolant<spline_t>(std::move(def), "", "");
+  auto cursor = spline.cursor();
+  // small steps along a track with occasional jumps and points out of range
+  std::normal_distribution<double> step(0, 0.5);
+  std::uniform_real_distribution<double> dis(low - 5, high + 5);
+  auto x = 50.;
+  for (int i = 0; i < 10'000; ++i) {
+    x = i % 100 == 0 ? dis(gen) : x + step(gen);
+    auto f = spline.evaluate(x);
+    EXPECT_NEAR(f, cursor.evaluate(x), std::abs(f) * 1e-12);
+    auto res = spline.evaluate_with_derivatives(x, true);
+    auto r = cursor.evaluate_with_derivatives(x, true);
+    EXPECT_NEAR(res.gradient[0], r.gradient[0], std::abs(res.gradient[0]) * 1e-10 + 1e-12);
+    EXPECT_NEAR(res.hessian[0], r.hessian[0], std::abs(res.hessian[0]) * 1e-10 + 1e-12);
+    EXPECT_NEAR(spline.prime(x), cursor.prime(x), std::abs(res.gradient[0]) * 1e-10 + 1e-12);
+  }
+}
+
+TEST(CubicSplines, parallel_build) {
+  size_t N = 100;
+  auto low = 1.e0f;
+  auto high = 1.e2f;
+  auto path = std::string("/tmp");
+  auto make_def = [&](cubic_splines::Executor executor) {
+    auto def = spline_def_t();
+    def.f = [](double x) { return std::sin(x) + 2; };
+    def.f_trafo = std::make_unique<cubic_splines::ExpAxis<double>>(1, 0);
+    def.axis = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+    def.executor = std::move(executor);
+    return def;
+  };
+  auto read = [&path](std::string const &filename) {
+    auto ifs = std::ifstream(path + "/" + filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(ifs), {});
+  };
+  auto files = std::array<std::string, 2>{"TestCubicSplines_parallel_build_serial.txt",
+                                          "TestCubicSplines_parallel_build.txt"};
+  for (auto const &filename : files)
+    std::remove((path + "/" + filename).c_str());
+  auto serial = cubic_splines::Interpolant<spline_t>(make_def(nullptr), path, files[0]);
+  auto parallel = cubic_splines::Interpolant<spline_t>(
+      make_def(cubic_splines::thread_executor(4)), path, files[1]);
+  // the stored tables have to be identical
+  EXPECT_FALSE(read(files[0]).empty());
+  EXPECT_EQ(read(files[0]), read(files[1]));
+  std::uniform_real_distribution<double> dis(low, high);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = dis(gen);
+    EXPECT_EQ(serial.evaluate(x), parallel.evaluate(x));
+  }
+  for (auto const &filename : files)
+    std::remove((path + "/" + filename).c_str());
+}
+
+TEST(CubicSplines, finite_difference) {
+  // the stencil has to reproduce boost exactly, tables stay identical
+  std::uniform_real_distribution<double> dis(0, 100);
+  auto func = [](double x) { return std::sin(x) * std::exp(x / 50); };
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = i < 2 ? double(i) : dis(gen);
+    using fd_t = cubic_splines::detail::FiniteDifference<double>;
+    auto fd = fd_t(x);
+    auto y = std::array<double, fd_t::n_points>();
+    auto stencil = fd.stencil();
+    for (size_t k = 0; k < fd_t::n_points; ++k)
+      y[k] = func(stencil[k]);
+    EXPECT_EQ(boost::math::differentiation::finite_difference_derivative(func, x),
+              fd.derivative(y.data()));
+  }
+}
+
+TEST(CubicSplines, batch_function) {
+  size_t N = 100;
+  auto low = 1.e0f;
+  auto high = 1.e2f;
+  auto func = [](double x) { return std::sin(x) + 2; };
+  std::atomic<unsigned int> calls(0);
+  auto make_def = [&](bool batch, cubic_splines::Executor executor) {
+    auto def = spline_def_t();
+    if (batch)
+      def.f_batch = [&](double const *x, double *out, size_t n) {
+        ++calls;
+        for (size_t k = 0; k < n; ++k)
+          out[k] = func(x[k]);
+      };
+    else
+      def.f = func;
+    def.f_trafo = std::make_unique<cubic_splines::ExpAxis<double>>(1, 0);
+    def.axis = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+    def.executor = std::move(executor);
+    return def;
+  };
+  auto single = spline_t(make_def(false, nullptr));
+  auto batch = spline_t(make_def(true, nullptr));
+  // the nodes and both boundary stencils are sampled at once
+  EXPECT_EQ(calls.load(), 1u);
+  auto parallel = spline_t(make_def(true, cubic_splines::thread_executor(4)));
+  std::uniform_real_distribution<double> dis(0, N - 1);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = dis(gen);
+    EXPECT_EQ(single.evaluate(x), batch.evaluate(x));
+    EXPECT_EQ(single.evaluate(x), parallel.evaluate(x));
+  }
+}
+
+TEST(CubicSplines, build_statistics) {
+  auto path = std::string("/tmp");
+  auto filename = std::string("TestCubicSplines_statistics.txt");
+  std::remove((path + "/" + filename).c_str());
+  auto stats = cubic_splines::BuildStatistics();
+  auto progress = std::vector<std::string>();
+  stats.progress = [&](std::string const &phase, double fraction) {
+    if (fraction == 1.)
+      progress.push_back(phase);
+  };
+  auto make_def = [&]() {
+    auto def = spline_def_t();
+    def.f = [](double x) { return std::sin(x); };
+    def.axis = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{20});
+    def.statistics = &stats;
+    return def;
+  };
+  auto built = cubic_splines::Interpolant<spline_t>(make_def(), path, filename);
+  auto phases = std::vector<std::string>();
+  for (auto const &p : stats.phases)
+    phases.push_back(p.name);
+  EXPECT_EQ(phases, (std::vector<std::string>{"load", "nodes", "splines", "save"}));
+  EXPECT_EQ(progress, (std::vector<std::string>{"nodes", "splines", "save"}));
+  // the nodes and the stencils of both boundary derivatives
+  auto nodes = built.GetDefinition().axis->required_nodes();
+  EXPECT_EQ(stats.function_evaluations, nodes + 12);
+  EXPECT_EQ(stats.peak_memory, (nodes + 2) * sizeof(double));
+  auto written = stats.serialized_bytes;
+  EXPECT_GT(written, nodes * sizeof(double));
+
+  stats = cubic_splines::BuildStatistics();
+  auto loaded = cubic_splines::Interpolant<spline_t>(make_def(), path, filename);
+  ASSERT_EQ(stats.phases.size(), 1u);
+  EXPECT_EQ(stats.phases[0].name, "load");
+  EXPECT_EQ(stats.function_evaluations, 0u);
+  EXPECT_EQ(stats.serialized_bytes, written);
+  std::remove((path + "/" + filename).c_str());
+}
+
+TEST(CubicSplines, refined_axis) {
+  auto base = std::make_unique<cubic_splines::ExpAxis<double>>(1, 1e3, std::log(10.));
+  auto refined = cubic_splines::RefinedAxis<double>(
+      std::make_unique<cubic_splines::ExpAxis<double>>(1, 1e3, std::log(10.)),
+      std::vector<unsigned int>{0, 1, 2});
+  EXPECT_EQ(1u + 2 + 4 + 1, refined.required_nodes());
+  // the base nodes are kept, the cells are split monotonically
+  EXPECT_EQ(refined.back_transform(0), base->back_transform(0));
+  EXPECT_NEAR(refined.back_transform(1), base->back_transform(1), 1e-12);
+  EXPECT_NEAR(refined.back_transform(3), base->back_transform(2), 1e-10);
+  EXPECT_NEAR(refined.back_transform(7), base->back_transform(3), 1e-9);
+  for (auto u = 0.; u < 7; u += 0.25)
+    EXPECT_LT(refined.back_transform(u), refined.back_transform(u + 0.25));
+
+  // the map is continuously differentiable
+  auto h = 1e-5;
+  for (auto x : {1.5, 9.9, 10.1, 42., 420., 800.}) {
+    auto u = refined.transform(x);
+    EXPECT_NEAR(refined.back_transform(u), x, x * 1e-12);
+    EXPECT_NEAR(refined.derive(x),
+                (refined.transform(x * (1 + h)) - refined.transform(x * (1 - h))) /
+                    (2 * h * x),
+                1e-6 * std::abs(refined.derive(x)));
+    EXPECT_NEAR(refined.double_derive(x),
+                (refined.derive(x * (1 + h)) - refined.derive(x * (1 - h))) / (2 * h * x),
+                1e-5 * std::abs(refined.double_derive(x)));
+    EXPECT_NEAR(refined.back_derive(u) * refined.derive(x), 1, 1e-12);
+    EXPECT_NEAR(refined.back_double_derive(u),
+                (refined.back_derive(u + h) - refined.back_derive(u - h)) / (2 * h),
+                1e-5 * std::abs(refined.back_double_derive(u)) + 1e-8);
+  }
+
+  // the neighbours are raised to keep the levels within one
+  auto lin = cubic_splines::RefinedAxis<double>(
+      std::make_unique<cubic_splines::LinAxis<double>>(0, 4, 1.));
+  EXPECT_EQ(5u, lin.required_nodes());
+  EXPECT_EQ(lin.transform(2.5), 2.5);
+  lin.refine({false, false, false, true});
+  lin.refine({false, false, false, false, true});
+  EXPECT_EQ(lin.levels(), (std::vector<unsigned int>{0, 0, 1, 2}));
+  EXPECT_EQ(1u + 1 + 2 + 4 + 1, lin.required_nodes());
+  EXPECT_EQ(lin.back_transform(2), 2.);
+  EXPECT_EQ(lin.back_transform(8), 4.);
+  EXPECT_THROW(cubic_splines::RefinedAxis<double>(
+                   std::make_unique<cubic_splines::LinAxis<double>>(0, 4, 1.),
+                   std::vector<unsigned int>{0, 1}),
+               std::invalid_argument);
+}
+
+TEST(CubicSplines, refine_axes) {
+  auto func = [](double x) { return std::exp(x) * std::sin(4 * x); };
+  auto def = spline_def_t();
+  def.f = func;
+  def.axis = std::make_unique<cubic_splines::LinAxis<double>>(0, 2, size_t{4});
+  auto res = cubic_splines::refine_axes<spline_t>(def, 1e-5, 1e-8);
+  EXPECT_TRUE(res.converged);
+  EXPECT_GT(res.levels, 0u);
+  EXPECT_EQ(def.axis->required_nodes(), res.nodes[0]);
+  // the cells are split at most once per level
+  EXPECT_LE(res.nodes[0] - 1, 3u << res.levels);
+
+  // a steep step only requires nodes close to it, the nodes which are sampled
+  // again are looked up
+  auto step = [](double x) { return std::tanh(20 * (x - 1.5)); };
+  auto calls = size_t{0};
+  auto local = spline_def_t();
+  local.f = [&](double x) {
+    ++calls;
+    return step(x);
+  };
+  local.axis = std::make_unique<cubic_splines::LinAxis<double>>(0, 2, size_t{9});
+  auto rel = 1e-4, abs = 1e-6;
+  res = cubic_splines::refine_axes<spline_t>(local, rel, abs);
+  EXPECT_TRUE(res.converged);
+  EXPECT_EQ(calls, res.function_evaluations);
+  auto refined = dynamic_cast<cubic_splines::RefinedAxis<double> *>(local.axis.get());
+  ASSERT_NE(refined, nullptr);
+  auto levels = refined->levels();
+  EXPECT_EQ(*std::max_element(levels.begin(), levels.end()), res.levels);
+  EXPECT_LT(levels.front(), res.levels);
+  EXPECT_LT(res.nodes[0] - 1, 8u << res.levels);
+  auto inter = cubic_splines::Interpolant<spline_t>(std::move(local), "", "");
+  std::uniform_real_distribution<double> dis(0, 2);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = dis(gen);
+    EXPECT_NEAR(step(x), inter.evaluate(x), 2 * (rel * std::max(std::abs(step(x)), 1.) + abs));
+  }
+
+  // an unreachable tolerance stops at the last level
+  auto coarse = spline_def_t();
+  coarse.f = func;
+  coarse.axis = std::make_unique<cubic_splines::LinAxis<double>>(0, 2, size_t{4});
+  res = cubic_splines::refine_axes<spline_t>(coarse, 0, 0, 2);
+  EXPECT_FALSE(res.converged);
+  EXPECT_EQ(res.levels, 2u);
+}
+
+TEST(CubicSplines, async_interpolant) {
+  auto make_def = []() {
+    auto def = spline_def_t();
+    def.f = [](double x) { return std::sin(x); };
+    def.axis = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{20});
+    return def;
+  };
+  // evaluations are exact before and interpolated after the build
+  auto async = cubic_splines::AsyncInterpolant<spline_t>(make_def(), "", "",
+                                                         cubic_splines::Pending::direct);
+  auto blocking = cubic_splines::Interpolant<spline_t>(make_def(), "", "");
+  std::uniform_real_distribution<double> dis(1, 10);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = dis(gen);
+    auto out = 0.;
+    async.evaluate(&x, &out, 1);
+    EXPECT_NEAR(out, blocking.evaluate(x), 1e-3);
+  }
+  async.wait();
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = dis(gen);
+    EXPECT_EQ(async.evaluate(x), blocking.evaluate(x));
+  }
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
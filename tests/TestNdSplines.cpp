@@ -0,0 +1,192 @@
+#include "CubicInterpolation/Axis.h"
+#include "CubicInterpolation/Interpolant.h"
+#include "CubicInterpolation/NdSplines.h"
+#include "gtest/gtest.h"
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+std::random_device rd;
+std::mt19937 gen(rd());
+
+using spline_t = cubic_splines::NdSplines<double, 3>;
+using spline_def_t = cubic_splines::NdSplines<double, 3>::Definition;
+
+TEST(NdSplines, evaluate_cubic_polynom) {
+  size_t N = 8;
+  auto low = -2.f;
+  auto high = 2.f;
+  auto func = [](std::array<double, 3> const &x) {
+    return x[0] * x[0] * x[0] - 2 * x[1] * x[1] * x[2] + x[0] * x[2] + 1;
+  };
+  auto def = spline_def_t();
+  def.f = func;
+  for (auto &axis : def.axis)
+    axis = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+  auto spline = cubic_splines::Interpolant<spline_t>(std::move(def), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  for (int i = 0; i < 10'000; ++i) {
+    auto x = std::array<double, 3>{dis(gen), dis(gen), dis(gen)};
+    EXPECT_NEAR(func(x), spline.evaluate(x), 1e-10);
+    auto res = spline.evaluate_with_derivatives(x, true);
+    EXPECT_DOUBLE_EQ(spline.evaluate(x), res.value);
+    EXPECT_NEAR(3 * x[0] * x[0] + x[2], res.gradient[0], 1e-9);
+    EXPECT_NEAR(-4 * x[1] * x[2], res.gradient[1], 1e-9);
+    EXPECT_NEAR(-2 * x[1] * x[1] + x[0], res.gradient[2], 1e-9);
+    EXPECT_NEAR(6 * x[0], res.hessian[0], 1e-8);
+    EXPECT_NEAR(-4 * x[2], res.hessian[1], 1e-8);
+    EXPECT_NEAR(0., res.hessian[2], 1e-8);
+    EXPECT_NEAR(0., res.hessian[3], 1e-8);
+    EXPECT_NEAR(1., res.hessian[4], 1e-8);
+    EXPECT_NEAR(-4 * x[1], res.hessian[5], 1e-8);
+  }
+}
+
+TEST(NdSplines, evaluate_log_func_values_and_axis) {
+  size_t N = 30;
+  auto low = 1.e0f;
+  auto high = 1.e2f;
+  using spline_4d_t = cubic_splines::NdSplines<double, 4>;
+  auto func = [](std::array<double, 4> const &x) { return x[0] * x[1] + x[2] / x[3]; };
+  auto def = spline_4d_t::Definition();
+  def.f = func;
+  def.f_trafo = std::make_unique<cubic_splines::ExpAxis<double>>(1, 0);
+  for (auto &axis : def.axis)
+    axis = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+  auto spline = cubic_splines::Interpolant<spline_4d_t>(std::move(def), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = std::array<double, 4>{dis(gen), dis(gen), dis(gen), dis(gen)};
+    EXPECT_NEAR(func(x), spline.evaluate(x), func(x) * 1e-3);
+  }
+}
+
+TEST(NdSplines, batch_evaluation) {
+  size_t N = 10;
+  auto low = 1.e0f;
+  auto high = 1.e1f;
+  auto def = spline_def_t();
+  def.f = [](std::array<double, 3> const &x) { return (2 + std::sin(x[0])) * x[1] + x[2]; };
+  def.f_trafo = std::make_unique<cubic_splines::ExpAxis<double>>(1, 0);
+  for (auto &axis : def.axis)
+    axis = std::make_unique<cubic_splines::ExpAxis<double>>(low, high, N);
+  auto spline = cubic_splines::Interpolant<spline_t>(std::move(def), "", "");
+  std::uniform_real_distribution<double> dis(low, high);
+  auto x = std::vector<double>(3 * 1'000);
+  for (auto &xi : x)
+    xi = dis(gen);
+  auto f = std::vector<double>(x.size() / 3);
+  auto df = std::vector<double>(x.size());
+  spline.evaluate(x.data(), f.data(), f.size());
+  spline.prime(x.data(), df.data(), f.size());
+  for (size_t k = 0; k < f.size(); ++k) {
+    auto p = std::array<double, 3>{x[3 * k], x[3 * k + 1], x[3 * k + 2]};
+    auto f_k = spline.evaluate(p);
+    EXPECT_NEAR(f_k, f[k], std::abs(f_k) * 1e-12);
+    auto grad = spline.prime(p);
+    auto norm = std::abs(grad[0]) + std::abs(grad[1]) + std::abs(grad[2]);
+    for (size_t i = 0; i < 3; ++i)
+      EXPECT_NEAR(grad[i], df[3 * k + i], norm * 1e-12);
+  }
+}
+
+TEST(NdSplines, storage) {
+  size_t N = 6;
+  auto low = 1.f;
+  auto high = 10.f;
+  auto path = std::string("/tmp");
+  auto filename = std::string("TestNdSplines_storage.txt");
+  std::remove((path + "/" + filename).c_str());
+  auto make_def = [&]() {
+    auto def = spline_def_t();
+    def.f = [](std::array<double, 3> const &x) { return x[0] * x[1] * x[2]; };
+    for (auto &axis : def.axis)
+      axis = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    return def;
+  };
+  auto built = cubic_splines::Interpolant<spline_t>(make_def(), path, filename);
+  auto loaded = cubic_splines::Interpolant<spline_t>(make_def(), path, filename);
+  std::uniform_real_distribution<double> dis(low, high);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = std::array<double, 3>{dis(gen), dis(gen), dis(gen)};
+    EXPECT_DOUBLE_EQ(built.evaluate(x), loaded.evaluate(x));
+  }
+  std::remove((path + "/" + filename).c_str());
+}
+
+TEST(NdSplines, layouts) {
+  size_t N = 9;
+  auto low = 1.f;
+  auto high = 10.f;
+  auto make_def = [&](spline_t::Layout layout) {
+    auto def = spline_def_t();
+    def.f = [](std::array<double, 3> const &x) { return std::sin(x[0]) * x[1] + x[2]; };
+    def.layout = layout;
+    for (auto &axis : def.axis)
+      axis = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    return def;
+  };
+  auto tensor = spline_t(make_def(spline_t::Layout::tensor));
+  auto cells = spline_t(make_def(spline_t::Layout::cells));
+  // points out of range are assigned to the boundary cells by both layouts
+  std::uniform_real_distribution<double> dis(low - 1, high + 1);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = std::array<double, 3>{dis(gen), dis(gen), dis(gen)};
+    EXPECT_EQ(tensor.evaluate(x), cells.evaluate(x));
+    auto a = tensor.evaluate_with_derivatives(x, true);
+    auto b = cells.evaluate_with_derivatives(x, true);
+    EXPECT_EQ(a.gradient, b.gradient);
+    EXPECT_EQ(a.hessian, b.hessian);
+  }
+}
+
+TEST(NdSplines, batch_sampling) {
+  size_t N = 7;
+  auto low = 1.f;
+  auto high = 10.f;
+  auto f = [](std::array<double, 3> const &x) { return x[0] * x[1] - x[2] * x[2]; };
+  auto make_def = [&]() {
+    auto def = spline_def_t();
+    for (auto &axis : def.axis)
+      axis = std::make_unique<cubic_splines::LinAxis<double>>(low, high, N);
+    return def;
+  };
+  auto def = make_def();
+  def.f = f;
+  auto batch_def = make_def();
+  auto calls = 0u;
+  batch_def.f_batch = [&](std::array<double const *, 3> const &x, double *out, size_t n) {
+    ++calls;
+    for (size_t k = 0; k < n; ++k)
+      out[k] = f({x[0][k], x[1][k], x[2][k]});
+  };
+  auto single = spline_t(def);
+  auto batch = spline_t(batch_def);
+  EXPECT_EQ(calls, 1u);
+  std::uniform_real_distribution<double> dis(low, high);
+  for (int i = 0; i < 1'000; ++i) {
+    auto x = std::array<double, 3>{dis(gen), dis(gen), dis(gen)};
+    EXPECT_EQ(single.evaluate(x), batch.evaluate(x));
+  }
+}
+
+TEST(NdSplines, too_few_nodes) {
+  auto calls = 0u;
+  auto def = spline_def_t();
+  def.f = [&](std::array<double, 3> const &x) {
+    ++calls;
+    return x[0] + x[1] + x[2];
+  };
+  def.axis[0] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{8});
+  def.axis[1] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{4});
+  def.axis[2] = std::make_unique<cubic_splines::LinAxis<double>>(1, 10, size_t{8});
+  EXPECT_THROW(spline_t{def}, std::invalid_argument);
+  EXPECT_EQ(calls, 0u);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}